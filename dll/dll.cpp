@@ -3,6 +3,8 @@
 
 #include "framework.h"
 #include "dll.h"
+#include "../src/RetryPolicy.hpp"
+#include "../src/HashKernels.hpp"
 
 static std::string ConvertWideToANSI(const std::wstring& wstr)
 {
@@ -25,6 +27,137 @@ static std::string GetRandomString()
     return str.substr(0, 8);
 }
 
+static std::string ToHex(const uint8_t* digest, const size_t length)
+{
+    std::string hex;
+
+    for (size_t index = 0; index < length; index++)
+    {
+        hex += fmt::format("{:02x}", digest[index]);
+    }
+
+    return hex;
+}
+
+/**
+ * \brief BLAKE3 behind the hash-library interface, single-threaded like the rest of the updater.
+ */
+class Blake3
+{
+    blake3_hasher state{};
+
+public:
+    Blake3()
+    {
+        blake3_hasher_init(&state);
+    }
+
+    void add(const void* data, const size_t length)
+    {
+        blake3_hasher_update(&state, data, length);
+    }
+
+    std::string getHash()
+    {
+        uint8_t digest[BLAKE3_OUT_LEN];
+        blake3_hasher_finalize(&state, digest, BLAKE3_OUT_LEN);
+        return ToHex(digest, BLAKE3_OUT_LEN);
+    }
+};
+
+/**
+ * \brief XXH3 with 128 bit output behind the hash-library interface, hex in canonical byte order.
+ */
+class Xxh128
+{
+    XXH3_state_t* state{XXH3_createState()};
+
+public:
+    Xxh128()
+    {
+        XXH3_128bits_reset(state);
+    }
+
+    Xxh128(const Xxh128&) = delete;
+    Xxh128& operator=(const Xxh128&) = delete;
+
+    ~Xxh128()
+    {
+        XXH3_freeState(state);
+    }
+
+    void add(const void* data, const size_t length)
+    {
+        XXH3_128bits_update(state, data, length);
+    }
+
+    std::string getHash()
+    {
+        XXH128_canonical_t canonical{};
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(state));
+        return ToHex(canonical.digest, sizeof(canonical.digest));
+    }
+};
+
+template <typename Algorithm>
+static std::string HashFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream.is_open())
+    {
+        return {};
+    }
+
+    Algorithm algorithm;
+    std::vector<char> buffer(1024 * 1024);
+
+    while (stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || stream.gcount() > 0)
+    {
+        algorithm.add(buffer.data(), static_cast<size_t>(stream.gcount()));
+    }
+
+    return stream.bad() ? std::string{} : algorithm.getHash();
+}
+
+/**
+ * \brief Hashes a file with the same kernels the main process uses.
+ * \param path The file to hash.
+ * \param algorithm The algorithm name as passed by the main process.
+ * \return The lowercase hex digest, empty on error or unknown algorithm.
+ */
+static std::string GetFileChecksum(const std::filesystem::path& path, const std::string& algorithm)
+{
+    const bool isAccelerated = hashing::GetAcceleratedKernel() != hashing::Kernel::Portable;
+
+    if (algorithm == "MD5")
+    {
+        return HashFile<MD5>(path);
+    }
+
+    if (algorithm == "SHA1")
+    {
+        return isAccelerated ? HashFile<hashing::AcceleratedSha1>(path) : HashFile<SHA1>(path);
+    }
+
+    if (algorithm == "SHA256")
+    {
+        return isAccelerated ? HashFile<hashing::AcceleratedSha256>(path) : HashFile<SHA256>(path);
+    }
+
+    if (algorithm == "BLAKE3")
+    {
+        return HashFile<Blake3>(path);
+    }
+
+    if (algorithm == "XXH128")
+    {
+        return HashFile<Xxh128>(path);
+    }
+
+    return {};
+}
+
 
 EXTERN_C DLL_API void CALLBACK PerformUpdate(HWND hwnd, HINSTANCE hinst, LPSTR lpszCmdLine, int nCmdShow)
 {
@@ -61,6 +194,8 @@ EXTERN_C DLL_API void CALLBACK PerformUpdate(HWND hwnd, HINSTANCE hinst, LPSTR l
         "--pid", // PID of the parent process
         "--url", // latest updater download URL
         "--path", // the target file path
+        "--checksum", // optional expected checksum of the download
+        "--checksum-alg", // algorithm of the checksum
         "--log-level"
     });
 
@@ -120,6 +255,10 @@ EXTERN_C DLL_API void CALLBACK PerformUpdate(HWND hwnd, HINSTANCE hinst, LPSTR l
         return;
     }
 
+    const std::string checksum = cmdl({"--checksum"}).str();
+    const std::string checksumAlg = cmdl({"--checksum-alg"}).str();
+    spdlog::debug("checksum = {} ({})", checksum, checksumAlg);
+
     std::filesystem::path original = cmdl({"--path"}).str();
     spdlog::debug("original = {}", original.string());
     const auto workDir = original.parent_path();
@@ -187,12 +326,87 @@ EXTERN_C DLL_API void CALLBACK PerformUpdate(HWND hwnd, HINSTANCE hinst, LPSTR l
         spdlog::debug("Moved file {} to hidden file {}", original.string(), tempFile);
 
         spdlog::debug("Starting download");
-        // download directly to main file stream
-        outStream.open(original, std::ios::binary | std::ofstream::ate);
-        outStream << curlpp::options::Url(url);
+
+        // a short outage of the download server must not leave us without an updater
+        net::RetryPolicy retry(5, std::chrono::seconds(1), std::chrono::seconds(30));
+
+        while (true)
+        {
+            // download directly to main file stream, dropping whatever a failed attempt left behind
+            outStream.open(original, std::ios::binary | std::ios::trunc);
+
+            std::optional<std::chrono::seconds> retryAfter;
+            curlpp::Easy request;
+
+            request.setOpt(curlpp::options::Url(url));
+            request.setOpt(curlpp::options::FollowLocation(true));
+            request.setOpt(curlpp::options::WriteStream(&outStream));
+            request.setOpt(curlpp::options::HeaderFunction(
+                [&retryAfter](char* buffer, size_t size, size_t nitems) -> size_t
+                {
+                    if (const auto delay = net::RetryPolicy::ParseRetryAfterLine(
+                        std::string_view(buffer, size * nitems)); delay.has_value())
+                    {
+                        retryAfter = delay;
+                    }
+
+                    return size * nitems;
+                }
+            ));
+
+            long code;
+
+            try
+            {
+                request.perform();
+                code = curlpp::infos::ResponseCode::get(request);
+            }
+            catch (curlpp::LibcurlRuntimeError& e)
+            {
+                spdlog::warn("Download attempt failed: {}", e.what());
+                code = e.whatCode();
+            }
+
+            outStream.close();
+
+            if (code == 200)
+            {
+                break;
+            }
+
+            spdlog::warn("GET request failed with code {}", code);
+
+            if (!retry.Wait(static_cast<int>(code), retryAfter))
+            {
+                throw curlpp::RuntimeError(fmt::format("Downloading {} failed with code {}", url, code));
+            }
+        }
 
         spdlog::info("Downloading {} finished", url);
 
+        // a corrupted or tampered binary must not replace a working updater
+        if (!checksum.empty())
+        {
+            const auto actual = GetFileChecksum(original, checksumAlg);
+
+            if (actual.empty())
+            {
+                throw curlpp::RuntimeError(fmt::format("Failed to calculate {} checksum of {}",
+                                                       checksumAlg, original.string()));
+            }
+
+            if (!std::ranges::equal(actual, checksum, [](const char lhs, const char rhs)
+            {
+                return std::tolower(static_cast<unsigned char>(lhs)) == std::tolower(static_cast<unsigned char>(rhs));
+            }))
+            {
+                throw curlpp::RuntimeError(fmt::format("Checksum of {} is {}, expected {} ({})",
+                                                       url, actual, checksum, checksumAlg));
+            }
+
+            spdlog::info("Checksum {} verified", checksum);
+        }
+
         if (DeleteFileA(tempFile.c_str()) == 0)
         {
             spdlog::warn("Failed to delete file {}, scheduling removal on reboot", tempFile);
@@ -22,8 +22,16 @@
 #include <curlpp/cURLpp.hpp>
 #include <curlpp/Easy.hpp>
 #include <curlpp/Options.hpp>
+#include <curlpp/Infos.hpp>
+#include <curlpp/Exception.hpp>
 
 #include <magic_enum.hpp>
 
+#include <hash-library/md5.h>
+#include <hash-library/sha1.h>
+#include <hash-library/sha256.h>
+#include <blake3.h>
+#include <xxhash.h>
+
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/msvc_sink.h>
@@ -33,7 +33,19 @@ public enum ChecksumAlgorithm
     ///     SHA256.
     /// </summary>
     [EnumMember(Value = nameof(SHA256))]
-    SHA256
+    SHA256,
+
+    /// <summary>
+    ///     BLAKE3, hashes large files on all cores.
+    /// </summary>
+    [EnumMember(Value = nameof(BLAKE3))]
+    BLAKE3,
+
+    /// <summary>
+    ///     XXH3 with 128 bit output. Not cryptographic, only use it to detect local changes.
+    /// </summary>
+    [EnumMember(Value = nameof(XXH128))]
+    XXH128
 }
 
 /// <summary>
@@ -65,7 +77,45 @@ public enum ProductVersionDetectionMethod
     ///     Calculates and compares the hash of a given file.
     /// </summary>
     [EnumMember(Value = nameof(FileChecksum))]
-    FileChecksum
+    FileChecksum,
+
+    /// <summary>
+    ///     Compares the sizes and hashes of a set of files in the product directory.
+    /// </summary>
+    [EnumMember(Value = nameof(FileManifest))]
+    FileManifest,
+
+    /// <summary>
+    ///     Combines several of the other methods, see <see cref="CompositeDetectionConfig" />.
+    /// </summary>
+    [EnumMember(Value = nameof(Composite))]
+    Composite
+}
+
+/// <summary>
+///     How the results of the rules of a <see cref="CompositeDetectionConfig" /> are combined.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+[Newtonsoft.Json.JsonConverter(typeof(StringEnumConverter))]
+public enum DetectionMode
+{
+    /// <summary>
+    ///     The product is up to date if all rules find it up to date.
+    /// </summary>
+    [EnumMember(Value = nameof(All))]
+    All,
+
+    /// <summary>
+    ///     The product is up to date if any rule finds it up to date, rules failing with an error count as outdated.
+    /// </summary>
+    [EnumMember(Value = nameof(Any))]
+    Any,
+
+    /// <summary>
+    ///     The first rule that can be evaluated decides, rules failing with an error fall through to the next one.
+    /// </summary>
+    [EnumMember(Value = nameof(FirstMatch))]
+    FirstMatch
 }
 
 /// <summary>
@@ -102,6 +152,8 @@ public enum RegistryHive
 [JsonDerivedType(typeof(FileVersionConfig), nameof(FileVersionConfig))]
 [JsonDerivedType(typeof(FileSizeConfig), nameof(FileSizeConfig))]
 [JsonDerivedType(typeof(FileChecksumConfig), nameof(FileChecksumConfig))]
+[JsonDerivedType(typeof(FileManifestConfig), nameof(FileManifestConfig))]
+[JsonDerivedType(typeof(CompositeDetectionConfig), nameof(CompositeDetectionConfig))]
 public abstract class ProductVersionDetectionImplementation
 {
 }
@@ -189,6 +241,95 @@ public sealed class FileChecksumConfig : ProductVersionDetectionImplementation
     public required string Hash { get; set; }
 }
 
+/// <summary>
+///     A file expected in the product directory.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+public sealed class FileManifestEntry
+{
+    /// <summary>
+    ///     The path relative to <see cref="FileManifestConfig.Root" />.
+    /// </summary>
+    [Required]
+    public required string Path { get; set; }
+
+    /// <summary>
+    ///     The expected file size in bytes. Checked before hashing, a mismatch flags the product as outdated.
+    /// </summary>
+    [Required]
+    public required long Size { get; set; }
+
+    /// <summary>
+    ///     The expected hash string. If the hashes do not match, the product is flagged as outdated.
+    /// </summary>
+    [Required]
+    public required string Hash { get; set; }
+}
+
+/// <summary>
+///     Compares the sizes and checksums/hashes of a set of files against the provided values.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+public sealed class FileManifestConfig : ProductVersionDetectionImplementation
+{
+    /// <summary>
+    ///     The absolute local path to the product directory.
+    /// </summary>
+    [Required]
+    public required string Root { get; set; }
+
+    /// <summary>
+    ///     The hashing algorithm to use for all files.
+    /// </summary>
+    [Required]
+    public required ChecksumAlgorithm Algorithm { get; set; }
+
+    /// <summary>
+    ///     The files to compare. If any of them is missing or differs, the product is flagged as outdated.
+    /// </summary>
+    [Required]
+    public required List<FileManifestEntry> Files { get; set; }
+}
+
+/// <summary>
+///     A single detection method within a <see cref="CompositeDetectionConfig" />.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+public sealed class DetectionRule
+{
+    /// <summary>
+    ///     The detection method, can't be <see cref="ProductVersionDetectionMethod.Composite" />.
+    /// </summary>
+    [Required]
+    public required ProductVersionDetectionMethod DetectionMethod { get; set; }
+
+    /// <summary>
+    ///     The details of the selected <see cref="DetectionMethod" />.
+    /// </summary>
+    [Required]
+    public required ProductVersionDetectionImplementation Detection { get; set; }
+}
+
+/// <summary>
+///     Combines several detection methods. Unless <see cref="DetectionMode.FirstMatch" /> is used, the client evaluates
+///     the cheapest rules first (registry, size, version resource, hash) and stops as soon as the outcome is certain.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+public sealed class CompositeDetectionConfig : ProductVersionDetectionImplementation
+{
+    /// <summary>
+    ///     How the results of the rules are combined.
+    /// </summary>
+    [Required]
+    public required DetectionMode Mode { get; set; }
+
+    /// <summary>
+    ///     The rules to evaluate.
+    /// </summary>
+    [Required]
+    public required List<DetectionRule> Rules { get; set; }
+}
+
 /// <summary>
 ///     Parameters that might be provided by both the server and the local configuration.
 /// </summary>
@@ -270,6 +411,35 @@ public sealed class ExitCodeCheck
     public List<int> SuccessCodes { get; set; } = new();
 }
 
+/// <summary>
+///     Limits detecting stalled payload downloads. Unset values keep the client defaults.
+/// </summary>
+[SuppressMessage("ReSharper", "UnusedAutoPropertyAccessor.Global")]
+[SuppressMessage("ReSharper", "UnusedMember.Global")]
+public sealed class TransferTimeouts
+{
+    /// <summary>
+    ///     Seconds to wait for a connection to be established.
+    /// </summary>
+    public int? ConnectTimeout { get; set; }
+
+    /// <summary>
+    ///     Transfers slower than this many bytes per second for <see cref="LowSpeedTime" /> seconds are considered
+    ///     stalled.
+    /// </summary>
+    public int? LowSpeedLimit { get; set; }
+
+    /// <summary>
+    ///     The window in seconds <see cref="LowSpeedLimit" /> is measured over.
+    /// </summary>
+    public int? LowSpeedTime { get; set; }
+
+    /// <summary>
+    ///     Seconds without receiving any data after which a transfer is considered stalled.
+    /// </summary>
+    public int? IdleTimeout { get; set; }
+}
+
 /// <summary>
 ///     Parameters for checksum/hash calculation.
 /// </summary>
@@ -314,8 +484,18 @@ public sealed class UpdateRelease
     /// <summary>
     ///     Summary/changelog/description of the release. Supports Markdown syntax.
     /// </summary>
-    [Required]
-    public string Summary { get; set; } = null!;
+    /// <remarks>Can be omitted in favour of <see cref="SummaryUrl" /> to keep the response small.</remarks>
+    public string? Summary { get; set; }
+
+    /// <summary>
+    ///     Optional URL to the Markdown summary, fetched by the client only when it gets displayed.
+    /// </summary>
+    public string? SummaryUrl { get; set; }
+
+    /// <summary>
+    ///     Optional checksum of the content behind <see cref="SummaryUrl" />, also used as client cache key.
+    /// </summary>
+    public ChecksumParameters? SummaryChecksum { get; set; }
 
     /// <summary>
     ///     The release publish timestamp.
@@ -333,6 +513,13 @@ public sealed class UpdateRelease
     [Required]
     public string DownloadUrl { get; set; } = null!;
 
+    /// <summary>
+    ///     Optional further URLs serving the identical file, e.g. on other CDNs. The client picks the fastest one and
+    ///     switches to another one if it fails mid-transfer.
+    /// </summary>
+    /// <remarks>Set <see cref="Checksum" /> so the client can continue partial downloads across mirrors.</remarks>
+    public List<string>? DownloadMirrors { get; set; }
+
     /// <summary>
     ///     Optional size (in bytes) of the download target. If this is not set, the UI will simply display "N/A" until the
     ///     actual download starts.
@@ -359,6 +546,11 @@ public sealed class UpdateRelease
     ///     Skips/disables this release on the client if set.
     /// </summary>
     public bool? Disabled { get; set; }
+
+    /// <summary>
+    ///     Optional release channel (e.g. "beta") this release belongs to.
+    /// </summary>
+    public string? Channel { get; set; }
 }
 
 /// <summary>
@@ -384,6 +576,11 @@ public sealed class UpdateConfig
     /// </summary>
     public string? LatestUrl { get; set; }
 
+    /// <summary>
+    ///     Optional checksum of the updater binary behind <see cref="LatestUrl" />, verified by the self-updater.
+    /// </summary>
+    public ChecksumParameters? LatestChecksum { get; set; }
+
     /// <summary>
     ///     The emergency URL. See https://docs.nefarius.at/projects/Vicius/Emergency-Feature/
     /// </summary>
@@ -393,6 +590,11 @@ public sealed class UpdateConfig
     ///     Setup exit code parameters.
     /// </summary>
     public ExitCodeCheck? ExitCode { get; set; }
+
+    /// <summary>
+    ///     Overrides the stall detection limits of release downloads.
+    /// </summary>
+    public TransferTimeouts? DownloadTimeouts { get; set; }
 }
 
 /// <summary>
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <neargye/semver.hpp>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
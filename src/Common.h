@@ -15,6 +15,7 @@
 #define NV_CLI_IGNORE_BUSY_STATE    "--ignore-busy-state"
 #define NV_CLI_PARAM_LOG_TO_FILE    "--log-to-file"
 #define NV_CLI_PARAM_SERVER_URL     "--server-url"
+#define NV_CLI_HASH_BENCHMARK       "--hash-benchmark"
 
 //
 // App error exit codes
@@ -32,7 +33,9 @@
 #define NV_S_SELF_UPDATER           201
 #define NV_S_UP_TO_DATE             202
 #define NV_S_UPDATE_FINISHED        203
+#define NV_S_HASH_BENCHMARK         204
 
+#include "Version.hpp"
 
 //
 // Functions
@@ -53,12 +56,15 @@ namespace ui
 namespace util
 {
     std::filesystem::path GetImageBasePathW();
-    semver::version GetVersionFromFile(const std::filesystem::path& filePath);
+    std::optional<Version> GetVersionFromFile(const std::filesystem::path& filePath);
+    std::optional<Version> GetImageVersion();
     bool ParseCommandLineArguments(argh::parser& cmdl);
     std::string trim(const std::string& str, const std::string& whitespace = " \t");
+    bool ParseHeaderLine(const char* buffer, size_t length, std::string& name, std::string& value);
     bool icompare_pred(unsigned char a, unsigned char b);
     bool icompare(const std::string& a, const std::string& b);
     bool IsAdmin(int& errorCode);
+    void WriteFileAtomically(const std::filesystem::path& file, const void* data, size_t size);
 }
 
 namespace winapi
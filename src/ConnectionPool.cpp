@@ -0,0 +1,749 @@
+#include "pch.h"
+#include "Common.h"
+#include "ConnectionPool.hpp"
+
+
+namespace
+{
+    /** Upper bound of idle handles kept around */
+    constexpr size_t MaxIdleHandles = 8;
+
+    std::mutex instanceLock;
+    std::unique_ptr<net::ConnectionPool> instance;
+
+    /**
+     * \brief Extracts scheme, host and port of a URL.
+     */
+    std::string GetOrigin(const std::string_view url)
+    {
+        const auto schemeEnd = url.find("://");
+        const auto hostStart = schemeEnd == std::string_view::npos ? 0 : schemeEnd + 3;
+        const auto hostEnd = url.find_first_of("/?#", hostStart);
+
+        return std::string(url.substr(0, hostEnd));
+    }
+
+    /** Upper bound of how long a persisted address is trusted, regardless of its TTL */
+    constexpr int64_t MaxAddressLifetime = 24 * 60 * 60;
+
+    int64_t GetUnixTime()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * \brief Splits a URL into host name and port.
+     */
+    bool GetHostAndPort(const char* url, std::string& host, int& port)
+    {
+        CURLU* parts = curl_url();
+        char* hostPart = nullptr;
+        char* portPart = nullptr;
+
+        const bool isValid = curl_url_set(parts, CURLUPART_URL, url, 0) == CURLUE_OK &&
+            curl_url_get(parts, CURLUPART_HOST, &hostPart, 0) == CURLUE_OK &&
+            curl_url_get(parts, CURLUPART_PORT, &portPart, CURLU_DEFAULT_PORT) == CURLUE_OK;
+
+        if (isValid)
+        {
+            host = hostPart;
+            port = std::atoi(portPart);
+        }
+
+        curl_free(hostPart);
+        curl_free(portPart);
+        curl_url_cleanup(parts);
+
+        return isValid;
+    }
+
+    /**
+     * \brief Asks the system resolver cache how much longer the address of a host stays valid.
+     * \return The remaining TTL in seconds, empty if the host isn't cached (anymore).
+     */
+    std::optional<DWORD> GetRemainingTtl(const std::string& host, const std::string& address)
+    {
+        const WORD type = address.find(':') == std::string::npos ? DNS_TYPE_A : DNS_TYPE_AAAA;
+        PDNS_RECORD records = nullptr;
+
+        // only consults the local cache, never goes on the wire
+        if (DnsQuery_A(host.c_str(), type, DNS_QUERY_NO_WIRE_QUERY, nullptr, &records, nullptr) != ERROR_SUCCESS)
+        {
+            return std::nullopt;
+        }
+
+        std::optional<DWORD> ttl;
+
+        for (auto record = records; record != nullptr; record = record->pNext)
+        {
+            if (record->wType == type)
+            {
+                ttl = std::min(ttl.value_or(MAXDWORD), record->dwTtl);
+            }
+        }
+
+        DnsRecordListFree(records, DnsFreeRecordList);
+
+        return ttl;
+    }
+
+    /**
+     * \brief Encrypts or decrypts data with the key of the current user.
+     */
+    bool ProtectData(const std::vector<uint8_t>& input, std::vector<uint8_t>& output, const bool isEncrypting)
+    {
+        DATA_BLOB in{static_cast<DWORD>(input.size()), const_cast<BYTE*>(input.data())};
+        DATA_BLOB out{};
+
+        const BOOL isDone = isEncrypting
+                                ? CryptProtectData(&in, nullptr, nullptr, nullptr, nullptr,
+                                                   CRYPTPROTECT_UI_FORBIDDEN, &out)
+                                : CryptUnprotectData(&in, nullptr, nullptr, nullptr, nullptr,
+                                                     CRYPTPROTECT_UI_FORBIDDEN, &out);
+
+        if (!isDone)
+        {
+            return false;
+        }
+
+        output.assign(out.pbData, out.pbData + out.cbData);
+        LocalFree(out.pbData);
+
+        return true;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    CURLcode ExportSession(CURL* handle, void* userptr, const char* sessionKey, const unsigned char* shmac,
+                           size_t shmacLength, const unsigned char* data, size_t dataLength,
+                           curl_off_t validUntil, int tlsVersion, const char* alpn, size_t earlyDataMax)
+    {
+        UNREFERENCED_PARAMETER(handle);
+        UNREFERENCED_PARAMETER(tlsVersion);
+        UNREFERENCED_PARAMETER(alpn);
+        UNREFERENCED_PARAMETER(earlyDataMax);
+
+        if (validUntil <= GetUnixTime())
+        {
+            return CURLE_OK;
+        }
+
+        models::TlsSession session;
+        session.sessionKey = sessionKey != nullptr ? sessionKey : "";
+        session.shmac.assign(shmac, shmac + shmacLength);
+        session.expiresAt = validUntil;
+
+        // a session ticket is as good as a password for resuming the connection
+        if (ProtectData(std::vector<uint8_t>(data, data + dataLength), session.data, true))
+        {
+            static_cast<std::vector<models::TlsSession>*>(userptr)->push_back(std::move(session));
+        }
+
+        return CURLE_OK;
+    }
+#endif
+}
+
+net::ConnectionPool::ConnectionPool()
+{
+    share = curl_share_init();
+
+    if (share == nullptr)
+    {
+        spdlog::error("Failed to create curl share handle");
+        return;
+    }
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, LockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, UnlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // no CURL_LOCK_DATA_CONNECT, libcurl doesn't support a connection cache used from several threads at once;
+    // transfers reuse connections through the multi handle instead
+}
+
+net::ConnectionPool::~ConnectionPool()
+{
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard guard(transferLock);
+            isStopping = true;
+        }
+
+        curl_multi_wakeup(multi);
+        worker.join();
+    }
+
+    // closes the connections the transfers of Perform left open
+    if (multi != nullptr)
+    {
+        curl_multi_cleanup(multi);
+    }
+
+    for (const auto handle : idle)
+    {
+        curl_easy_cleanup(handle);
+    }
+
+    idle.clear();
+
+    for (const auto& [handle, list] : resolveLists)
+    {
+        curl_slist_free_all(list);
+    }
+
+    if (share != nullptr)
+    {
+        curl_share_cleanup(share);
+    }
+}
+
+void net::ConnectionPool::LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr)
+{
+    UNREFERENCED_PARAMETER(handle);
+    UNREFERENCED_PARAMETER(access);
+
+    static_cast<ConnectionPool*>(userptr)->shareLocks[data].lock();
+}
+
+void net::ConnectionPool::UnlockShare(CURL* handle, curl_lock_data data, void* userptr)
+{
+    UNREFERENCED_PARAMETER(handle);
+
+    static_cast<ConnectionPool*>(userptr)->shareLocks[data].unlock();
+}
+
+net::ConnectionPool& net::ConnectionPool::Instance()
+{
+    std::lock_guard guard(instanceLock);
+
+    if (instance == nullptr)
+    {
+        instance = std::make_unique<ConnectionPool>();
+    }
+
+    return *instance;
+}
+
+void net::ConnectionPool::Shutdown()
+{
+    std::lock_guard guard(instanceLock);
+
+    if (instance != nullptr)
+    {
+        instance->LogStatistics();
+
+        if (!instance->cacheFile.empty())
+        {
+            instance->SaveCache();
+        }
+
+        instance.reset();
+    }
+}
+
+CURL* net::ConnectionPool::Acquire()
+{
+    CURL* handle = nullptr;
+
+    {
+        std::lock_guard guard(lock);
+
+        // any handle will do, the connections of transfers run through the pool live in its multi handle
+        if (!idle.empty())
+        {
+            handle = idle.back();
+            idle.pop_back();
+        }
+    }
+
+    if (handle == nullptr)
+    {
+        handle = curl_easy_init();
+    }
+
+    if (handle != nullptr && share != nullptr)
+    {
+        curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    }
+
+    if (handle != nullptr)
+    {
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(NV_HTTP_VERSION));
+        // on a multi handle, rather wait for a connection that might turn out to multiplex than open another one
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    }
+
+    if (curl_slist* resolveList = nullptr; handle != nullptr && (resolveList = CreateResolveList()) != nullptr)
+    {
+        curl_easy_setopt(handle, CURLOPT_RESOLVE, resolveList);
+
+        std::lock_guard guard(lock);
+        resolveLists[handle] = resolveList;
+    }
+
+    return handle;
+}
+
+void net::ConnectionPool::Release(CURL* handle)
+{
+    if (handle == nullptr)
+    {
+        return;
+    }
+
+    // only handles that performed a transfer have a URL
+    if (char* url = nullptr; curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK &&
+        url != nullptr && *url != '\0')
+    {
+        Record(handle, GetOrigin(url));
+    }
+
+    // drops all options, connections stay with the multi handle or the handle that performed on its own
+    curl_easy_reset(handle);
+
+    std::lock_guard guard(lock);
+
+    if (const auto resolveList = resolveLists.find(handle); resolveList != resolveLists.end())
+    {
+        curl_slist_free_all(resolveList->second);
+        resolveLists.erase(resolveList);
+    }
+
+    if (idle.size() >= MaxIdleHandles)
+    {
+        curl_easy_cleanup(idle.front());
+        idle.erase(idle.begin());
+    }
+
+    idle.push_back(handle);
+}
+
+bool net::ConnectionPool::Enqueue(CURL* handle)
+{
+    if (multi == nullptr)
+    {
+        multi = curl_multi_init();
+
+        if (multi == nullptr)
+        {
+            spdlog::error("Failed to create curl multi handle");
+            return false;
+        }
+
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        worker = std::thread(&ConnectionPool::RunWorker, this);
+    }
+
+    results[handle] = std::nullopt;
+    pending.push_back(handle);
+
+    curl_multi_wakeup(multi);
+
+    return true;
+}
+
+CURLcode net::ConnectionPool::Perform(CURL* handle)
+{
+    std::unique_lock guard(transferLock);
+
+    if (!Enqueue(handle))
+    {
+        return CURLE_OUT_OF_MEMORY;
+    }
+
+    transferDone.wait(guard, [this, handle]() { return results[handle].has_value(); });
+
+    const CURLcode result = results[handle].value();
+    results.erase(handle);
+
+    return result;
+}
+
+void net::ConnectionPool::Start(CURL* handle)
+{
+    std::lock_guard guard(transferLock);
+
+    // collected like any other failed transfer
+    if (!Enqueue(handle))
+    {
+        results[handle] = CURLE_OUT_OF_MEMORY;
+    }
+}
+
+std::optional<std::pair<CURL*, CURLcode>> net::ConnectionPool::WaitAny(const std::span<CURL* const> handles,
+                                                                      const std::chrono::milliseconds timeout)
+{
+    std::unique_lock guard(transferLock);
+    CURL* completed = nullptr;
+
+    transferDone.wait_for(guard, timeout, [this, handles, &completed]()
+    {
+        const auto handle = std::ranges::find_if(handles, [this](CURL* candidate)
+        {
+            const auto result = results.find(candidate);
+
+            return result != results.end() && result->second.has_value();
+        });
+
+        completed = handle == handles.end() ? nullptr : *handle;
+
+        return completed != nullptr;
+    });
+
+    if (completed == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    const CURLcode result = results[completed].value();
+    results.erase(completed);
+
+    return std::make_pair(completed, result);
+}
+
+void net::ConnectionPool::Abort(CURL* handle)
+{
+    std::unique_lock guard(transferLock);
+
+    const auto result = results.find(handle);
+
+    if (result == results.end())
+    {
+        return;
+    }
+
+    if (!result->second.has_value())
+    {
+        aborting.push_back(handle);
+        curl_multi_wakeup(multi);
+
+        transferDone.wait(guard, [this, handle]() { return results[handle].has_value(); });
+    }
+
+    results.erase(handle);
+}
+
+void net::ConnectionPool::RunWorker()
+{
+    int running = 0;
+
+    while (true)
+    {
+        {
+            std::lock_guard guard(transferLock);
+
+            for (const auto handle : pending)
+            {
+                if (const CURLMcode code = curl_multi_add_handle(multi, handle); code != CURLM_OK)
+                {
+                    spdlog::error("Failed to add transfer, error {}", curl_multi_strerror(code));
+                    results[handle] = CURLE_FAILED_INIT;
+                    transferDone.notify_all();
+                    continue;
+                }
+
+                running++;
+            }
+
+            pending.clear();
+
+            for (const auto handle : aborting)
+            {
+                // completed in the meantime, the result stays as it is
+                if (results[handle].has_value())
+                {
+                    continue;
+                }
+
+                curl_multi_remove_handle(multi, handle);
+                results[handle] = CURLE_ABORTED_BY_CALLBACK;
+                transferDone.notify_all();
+            }
+
+            aborting.clear();
+
+            // blocking callers can't be in flight when the pool goes away, so this only skips idle waits
+            if (isStopping && running == 0)
+            {
+                break;
+            }
+        }
+
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+
+        while (const CURLMsg* message = curl_multi_info_read(multi, &queued))
+        {
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            CURL* handle = message->easy_handle;
+            const CURLcode result = message->data.result;
+
+            curl_multi_remove_handle(multi, handle);
+
+            std::lock_guard guard(transferLock);
+            results[handle] = result;
+            transferDone.notify_all();
+        }
+
+        // returns early on socket activity or when Perform hands over a new transfer
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+}
+
+void net::ConnectionPool::Record(CURL* handle, const std::string& origin)
+{
+    long connects = 0;
+    char* address = nullptr;
+
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(handle, CURLINFO_PRIMARY_IP, &address);
+
+    const bool isConnected = address != nullptr && *address != '\0';
+
+    if (isConnected)
+    {
+        ++transferCount;
+        connectCount += static_cast<uint64_t>(connects);
+    }
+
+    if (!isConnected)
+    {
+        spdlog::debug("Transfer to {} didn't connect", origin);
+    }
+    else if (connects == 0)
+    {
+        ++reusedCount;
+        spdlog::debug("Transfer to {} reused a pooled connection", origin);
+    }
+    else
+    {
+        spdlog::debug("Transfer to {} opened {} new connection(s)", origin, connects);
+    }
+
+    if (cacheFile.empty())
+    {
+        return;
+    }
+
+    char* url = nullptr;
+    long addressPort = 0;
+    std::string host;
+    int port = 0;
+
+    curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &url);
+    curl_easy_getinfo(handle, CURLINFO_PRIMARY_PORT, &addressPort);
+
+    if (url == nullptr || !GetHostAndPort(url, host, port))
+    {
+        return;
+    }
+
+    std::lock_guard guard(lock);
+
+    const auto known = std::ranges::find_if(addresses, [&host, port](const models::ResolvedAddress& entry)
+    {
+        return entry.host == host && entry.port == port;
+    });
+
+    // nothing connected, a persisted address might have gone stale
+    if (!isConnected)
+    {
+        if (known != addresses.end() && known->expiresAt > 0)
+        {
+            spdlog::debug("Dropping persisted address {} of {}", known->address, host);
+            unreachable.push_back(std::format("{}:{}", host, port));
+            addresses.erase(known);
+        }
+
+        return;
+    }
+
+    // went through a proxy, the address isn't the host's
+    if (addressPort != port)
+    {
+        return;
+    }
+
+    if (known != addresses.end())
+    {
+        // the expiry gets determined once it's persisted
+        if (known->address != address)
+        {
+            known->address = address;
+            known->expiresAt = 0;
+        }
+    }
+    else
+    {
+        addresses.push_back({host, port, address, 0});
+    }
+}
+
+curl_slist* net::ConnectionPool::CreateResolveList()
+{
+    std::lock_guard guard(lock);
+
+    if (cacheFile.empty())
+    {
+        return nullptr;
+    }
+
+    const auto now = GetUnixTime();
+    curl_slist* list = nullptr;
+
+    // evict what was injected before, the resolver gets to try again
+    for (const auto& entry : unreachable)
+    {
+        list = curl_slist_append(list, std::format("-{}", entry).c_str());
+    }
+
+    unreachable.clear();
+
+    for (const auto& entry : addresses)
+    {
+        // the "+" makes the entry time out like a regular lookup result
+        if (entry.expiresAt > now)
+        {
+            list = curl_slist_append(list, std::format("+{}:{}:{}", entry.host, entry.port, entry.address).c_str());
+        }
+    }
+
+    return list;
+}
+
+void net::ConnectionPool::EnablePersistence(const std::filesystem::path& file)
+{
+    models::NetworkCache cache;
+
+    if (std::error_code ec; exists(file, ec))
+    {
+        try
+        {
+            std::ifstream stream(file, std::ios::binary);
+            const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+
+            cache = json::from_cbor(content).get<models::NetworkCache>();
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to read network cache {}, error {}", file.string(), e.what());
+        }
+    }
+
+    const auto now = GetUnixTime();
+
+    {
+        std::lock_guard guard(lock);
+
+        cacheFile = file;
+
+        std::ranges::copy_if(cache.addresses, std::back_inserter(addresses),
+                             [now](const models::ResolvedAddress& entry) { return entry.expiresAt > now; });
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    // sessions live in the share, any handle attached to it can take them
+    CURL* handle = Acquire();
+    size_t imported = 0;
+
+    for (const auto& session : cache.sessions)
+    {
+        std::vector<uint8_t> data;
+
+        if (session.expiresAt <= now || !ProtectData(session.data, data, false))
+        {
+            continue;
+        }
+
+        const auto result = curl_easy_ssls_import(
+            handle,
+            session.sessionKey.empty() ? nullptr : session.sessionKey.c_str(),
+            session.shmac.data(),
+            session.shmac.size(),
+            data.data(),
+            data.size()
+        );
+
+        // the TLS backend doesn't support it, no point in trying the others
+        if (result == CURLE_NOT_BUILT_IN)
+        {
+            break;
+        }
+
+        if (result == CURLE_OK)
+        {
+            imported++;
+        }
+    }
+
+    Release(handle);
+
+    spdlog::debug("Restored {} addresses and {} TLS sessions from {}", addresses.size(), imported, file.string());
+#else
+    spdlog::debug("Restored {} addresses from {}", addresses.size(), file.string());
+#endif
+}
+
+void net::ConnectionPool::SaveCache()
+{
+    models::NetworkCache cache;
+    const auto now = GetUnixTime();
+
+    {
+        std::lock_guard guard(lock);
+
+        for (auto entry : addresses)
+        {
+            // resolved during this run, take over the remaining lifetime the system resolver knows of
+            if (entry.expiresAt == 0)
+            {
+                const auto ttl = GetRemainingTtl(entry.host, entry.address);
+
+                if (!ttl.has_value() || ttl.value() == 0)
+                {
+                    continue;
+                }
+
+                entry.expiresAt = now + std::min<int64_t>(ttl.value(), MaxAddressLifetime);
+            }
+
+            if (entry.expiresAt > now)
+            {
+                cache.addresses.push_back(std::move(entry));
+            }
+        }
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    CURL* handle = Acquire();
+    curl_easy_ssls_export(handle, ExportSession, &cache.sessions);
+    Release(handle);
+#endif
+
+    try
+    {
+        const auto content = json::to_cbor(cache);
+
+        util::WriteFileAtomically(cacheFile, content.data(), content.size());
+
+        spdlog::debug("Persisted {} addresses and {} TLS sessions", cache.addresses.size(), cache.sessions.size());
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("Failed to write network cache {}, error {}", cacheFile.string(), e.what());
+    }
+}
+
+void net::ConnectionPool::LogStatistics() const
+{
+    spdlog::debug("Connection pool: {} transfers, {} reused a connection, {} connections opened",
+                  transferCount.load(), reusedCount.load(), connectCount.load());
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <curl/curl.h>
+
+#include "NetworkCache.hpp"
+
+
+namespace net
+{
+    /**
+     * \brief Process-wide pool of transfer handles sharing connections, DNS results and TLS sessions.
+     * \remarks Transfers run through Perform or Start draw from the connection cache of one multi handle,
+     *          so a request to an origin an earlier one of them talked to skips the TCP and TLS handshakes
+     *          entirely. HTTP/2 is negotiated where the server offers it, these transfers then share a
+     *          single multiplexed connection per origin instead of opening one each.
+     *          Handles performed on their own, e.g. on a thread of their own, keep their connections
+     *          to themselves, as libcurl doesn't support sharing a connection cache across threads.
+     *          All handles share the DNS cache and can resume TLS sessions established by any other
+     *          handle. Optionally DNS results and TLS sessions outlive the process, see EnablePersistence.
+     */
+    class ConnectionPool
+    {
+        CURLSH* share{nullptr};
+        /** One lock per shared data type, guarded by the share callbacks */
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> shareLocks;
+
+        std::mutex lock;
+        /** Handles waiting to be handed out again */
+        std::vector<CURL*> idle;
+
+        /** Where DNS results and TLS sessions are persisted, empty if they aren't */
+        std::filesystem::path cacheFile;
+        /** Addresses resolved by this or an earlier run, the latter carry their expiry */
+        std::vector<models::ResolvedAddress> addresses;
+        /** Persisted addresses that turned out to be unreachable, as "host:port" */
+        std::vector<std::string> unreachable;
+        /** Address overrides handed to each busy handle, must outlive its transfer */
+        std::map<CURL*, curl_slist*> resolveLists;
+
+        /** Drives the transfers handed to Perform and Start, created on first use */
+        CURLM* multi{nullptr};
+        std::thread worker;
+        std::mutex transferLock;
+        std::condition_variable transferDone;
+        /** Handles waiting to be added to the multi handle by the worker */
+        std::vector<CURL*> pending;
+        /** Handles waiting to be removed from the multi handle before they completed */
+        std::vector<CURL*> aborting;
+        /** Handles in flight, the result is set once the transfer completed */
+        std::map<CURL*, std::optional<CURLcode>> results;
+        bool isStopping{false};
+
+        std::atomic<uint64_t> transferCount{0};
+        std::atomic<uint64_t> reusedCount{0};
+        std::atomic<uint64_t> connectCount{0};
+
+        static void LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+        static void UnlockShare(CURL* handle, curl_lock_data data, void* userptr);
+
+        /**
+         * \brief Accounts the connections of the last transfer performed with the handle.
+         */
+        void Record(CURL* handle, const std::string& origin);
+
+        /**
+         * \brief Builds the address overrides pointing curl to the persisted, still valid addresses.
+         */
+        curl_slist* CreateResolveList();
+
+        /**
+         * \brief Writes the still valid DNS results and TLS sessions to the cache file.
+         */
+        void SaveCache();
+
+        /**
+         * \brief Hands a transfer over to the worker, the transfer lock must be held.
+         * \return False if the multi handle couldn't be created.
+         */
+        bool Enqueue(CURL* handle);
+
+        /**
+         * \brief Runs the transfers of the multi handle until the pool shuts down.
+         */
+        void RunWorker();
+
+    public:
+        ConnectionPool();
+        ~ConnectionPool();
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        /**
+         * \brief Gets the pool, creates it on first use.
+         */
+        static ConnectionPool& Instance();
+
+        /**
+         * \brief Logs the statistics and closes all pooled connections.
+         * \remarks Must be called before curl gets globally cleaned up, with no transfer in progress.
+         */
+        static void Shutdown();
+
+        /**
+         * \brief Hands out a transfer handle with default options.
+         * \return The handle or nullptr on failure.
+         */
+        CURL* Acquire();
+
+        /**
+         * \brief Takes a handle back once it's no longer used.
+         * \param handle The handle obtained by Acquire, may be nullptr.
+         */
+        void Release(CURL* handle);
+
+        /**
+         * \brief Performs a transfer on the shared multi handle, blocking like curl_easy_perform.
+         * \remarks Concurrent requests to the same HTTP/2 origin are multiplexed as streams over one
+         *          connection. All callbacks of the handle run on the worker thread and must return
+         *          quickly, a callback waiting on something stalls every other transfer in flight.
+         * \param handle The handle obtained by Acquire with all options set.
+         * \return The result of the transfer.
+         */
+        CURLcode Perform(CURL* handle);
+
+        /**
+         * \brief Starts a transfer on the shared multi handle without waiting for it.
+         * \remarks The same rules apply to the callbacks as with Perform. The transfer must be collected
+         *          with WaitAny or stopped with Abort before the handle gets released.
+         * \param handle The handle obtained by Acquire with all options set.
+         */
+        void Start(CURL* handle);
+
+        /**
+         * \brief Waits for one of the given transfers to complete.
+         * \param handles Transfers started with Start and not collected yet.
+         * \param timeout How long to wait at most.
+         * \return The completed handle and the result of its transfer, empty if none completed in time.
+         */
+        std::optional<std::pair<CURL*, CURLcode>> WaitAny(std::span<CURL* const> handles,
+                                                          std::chrono::milliseconds timeout);
+
+        /**
+         * \brief Stops a transfer started with Start, returns once the worker no longer uses the handle.
+         * \remarks Must not be called while holding a lock any callback of a transfer in flight waits for.
+         * \param handle The handle of the transfer, which may have completed already.
+         */
+        void Abort(CURL* handle);
+
+        /**
+         * \brief Restores DNS results and TLS sessions of an earlier run and persists them on shutdown.
+         * \param file Full pathname of the cache file.
+         */
+        void EnablePersistence(const std::filesystem::path& file);
+
+        /**
+         * \brief Logs how many transfers got away without opening a new connection.
+         */
+        void LogStatistics() const;
+    };
+}
@@ -8,6 +8,7 @@
 //
 // URL template (or absolute URL) where to find the update information
 // The {} will be replaced with the "manufacturer/product" sub-path
+// Mirrors can be listed separated by whitespace, they get raced if the fastest one is slow
 // CAUTION: set NV_FLAGS_NO_SERVER_URL_RESOURCE to enforce these values
 // See also https://docs.nefarius.at/projects/Vicius/Server-Discovery/
 // 
@@ -55,6 +56,62 @@
 // 
 #define NV_SUCCESS_EXIT_CODE    0
 
+//
+// Maximum number of parallel ranges used to download a release, HTTP/2 servers get them
+// as streams of one connection, HTTP/1.1 servers as one connection each
+// 
+#define NV_DOWNLOAD_MAX_CONNECTIONS     4
+
+//
+// Minimum size of each byte range of a segmented release download
+// 
+#define NV_DOWNLOAD_MIN_SEGMENT_SIZE    (8 * 1024 * 1024)
+
+//
+// Seconds to wait for a release download connection to be established
+// 
+#define NV_DOWNLOAD_CONNECT_TIMEOUT     15
+
+//
+// Release downloads slower than NV_DOWNLOAD_LOW_SPEED_LIMIT bytes per second
+// for NV_DOWNLOAD_LOW_SPEED_TIME seconds are considered stalled
+// 
+#define NV_DOWNLOAD_LOW_SPEED_LIMIT     1024
+#define NV_DOWNLOAD_LOW_SPEED_TIME      30
+
+//
+// Seconds without receiving any data after which a release download is considered stalled
+// 
+#define NV_DOWNLOAD_IDLE_TIMEOUT        60
+
+//
+// Attempts made to fetch the update information and release downloads before giving up
+// 
+#define NV_FEED_RETRY_ATTEMPTS          3
+#define NV_DOWNLOAD_RETRY_ATTEMPTS      5
+
+//
+// Bounds in milliseconds of the randomized delay between two attempts
+// 
+#define NV_RETRY_BASE_DELAY             1000
+#define NV_RETRY_MAX_DELAY              30000
+
+//
+// Milliseconds to wait for a feed mirror to respond before racing the next one
+// 
+#define NV_FEED_HEDGE_DELAY             500
+
+//
+// HTTP version requested from servers, the default negotiates HTTP/2 over TLS via ALPN
+// and falls back to HTTP/1.1, use CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE for cleartext h2c servers
+// 
+#define NV_HTTP_VERSION                 CURL_HTTP_VERSION_2TLS
+
+//
+// Maximum number of files hashed at once by the file manifest product detection
+// 
+#define NV_MANIFEST_MAX_THREADS         4
+
 
 /*
  * Compiler switches turning optional features on or off
@@ -88,3 +145,31 @@
 // Uncomment to always run install steps on launch
 // 
 //#define NV_FLAGS_ALWAYS_RUN_INSTALL
+
+//
+// Uncomment to always download releases with one single connection
+// 
+//#define NV_FLAGS_NO_SEGMENTED_DOWNLOAD
+
+//
+// Uncomment to always fetch the update information from the server, ignoring the local cache
+// 
+//#define NV_FLAGS_NO_FEED_CACHE
+
+//
+// Uncomment to look for precompressed siblings of the update information file
+// (e.g. updates.json.zst, updates.json.gz) first, useful for static hosting
+// 
+//#define NV_FLAGS_PRECOMPRESSED_FEED
+
+//
+// Uncomment to remember resolved addresses and TLS sessions across runs,
+// which skips DNS lookups and full TLS handshakes while they are still valid
+// 
+//#define NV_FLAGS_PERSIST_NETWORK_CACHE
+
+//
+// Uncomment to always hash files for checksum detection, instead of reusing
+// the digest of an earlier run while the file is unchanged
+// 
+//#define NV_FLAGS_NO_HASH_CACHE
@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "Common.h"
+#include "DetectionPlan.hpp"
+
+
+namespace
+{
+    std::optional<models::DetectionStep> CompileStep(const models::ProductVersionDetectionMethod method,
+                                                     const json& detection)
+    {
+        using models::ProductVersionDetectionMethod;
+
+        models::DetectionStep step{.method = method, .cost = models::DetectionPlan::EstimateCost(method)};
+
+        switch (method)
+        {
+        case ProductVersionDetectionMethod::RegistryValue:
+            step.parameters = detection.get<models::RegistryValueConfig>();
+            break;
+        case ProductVersionDetectionMethod::FileVersion:
+            step.parameters = detection.get<models::FileVersionConfig>();
+            break;
+        case ProductVersionDetectionMethod::FileSize:
+            step.parameters = detection.get<models::FileSizeConfig>();
+            break;
+        case ProductVersionDetectionMethod::FileChecksum:
+            step.parameters = detection.get<models::FileChecksumConfig>();
+            break;
+        case ProductVersionDetectionMethod::FileManifest:
+            step.parameters = detection.get<models::FileManifestConfig>();
+            break;
+        case ProductVersionDetectionMethod::Composite:
+            spdlog::error("Composite detection rules can't be nested");
+            return std::nullopt;
+        case ProductVersionDetectionMethod::Invalid:
+            spdlog::error("Invalid detection method specified");
+            return std::nullopt;
+        }
+
+        return step;
+    }
+}
+
+std::optional<models::DetectionPlan> models::DetectionPlan::Compile(const ProductVersionDetectionMethod method,
+                                                                    const json& detection)
+{
+    try
+    {
+        DetectionPlan plan;
+
+        if (method != ProductVersionDetectionMethod::Composite)
+        {
+            auto step = CompileStep(method, detection);
+
+            if (!step.has_value())
+            {
+                return std::nullopt;
+            }
+
+            plan.steps.push_back(std::move(step.value()));
+
+            return plan;
+        }
+
+        const auto config = detection.get<CompositeDetectionConfig>();
+
+        if (config.mode == DetectionMode::Invalid)
+        {
+            spdlog::error("Invalid composite detection mode specified");
+            return std::nullopt;
+        }
+
+        if (config.rules.empty())
+        {
+            spdlog::error("Composite detection has no rules");
+            return std::nullopt;
+        }
+
+        plan.mode = config.mode;
+        plan.steps.reserve(config.rules.size());
+
+        for (const auto& rule : config.rules)
+        {
+            auto step = CompileStep(rule.detectionMethod, rule.detection);
+
+            if (!step.has_value())
+            {
+                return std::nullopt;
+            }
+
+            plan.steps.push_back(std::move(step.value()));
+        }
+
+        // the outcome of All and Any doesn't depend on the order, so the cheapest checks get to decide first
+        if (plan.mode != DetectionMode::FirstMatch)
+        {
+            std::ranges::stable_sort(plan.steps, {}, &DetectionStep::cost);
+        }
+
+        return plan;
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("Failed to decode detection configuration, error {}", e.what());
+        return std::nullopt;
+    }
+}
@@ -6,6 +6,7 @@ enum class DownloadAndInstallStep
 	Downloading,
 	DownloadFailed,
 	DownloadSucceeded,
+	ChecksumMismatch,
 	PrepareInstall,
 	InstallLaunchFailed,
 	InstallRunning,
@@ -0,0 +1,1101 @@
+#include "pch.h"
+#include "Common.h"
+#include "Downloader.hpp"
+#include "ConnectionPool.hpp"
+
+
+net::Downloader::Downloader(DownloadOptions options) : options(std::move(options))
+{
+}
+
+net::Downloader::~Downloader()
+{
+    Cleanup();
+}
+
+size_t net::Downloader::WriteCallback(char* data, size_t size, size_t nmemb, void* userdata)
+{
+    auto* segment = static_cast<DownloadSegment*>(userdata);
+    const auto bytes = size * nmemb;
+
+    // validate the response before the first byte hits the disk
+    if (segment->statusCode == 0)
+    {
+        curl_easy_getinfo(segment->handle, CURLINFO_RESPONSE_CODE, &segment->statusCode);
+
+        if (segment->statusCode != (segment->IsRanged() ? 206 : 200))
+        {
+            segment->isRejected = true;
+            return 0;
+        }
+
+        curl_off_t contentLength = -1;
+        curl_easy_getinfo(segment->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+
+        std::lock_guard guard(segment->owner->segmentLock);
+        segment->contentLength = contentLength;
+    }
+
+    // server sent more than we asked for, the file layout would get corrupted
+    if (segment->IsRanged() && segment->cursor + static_cast<curl_off_t>(bytes) > segment->end + 1)
+    {
+        spdlog::error("Segment {}-{} received data beyond its range", segment->begin, segment->end);
+        return 0;
+    }
+
+    OVERLAPPED position{};
+    position.Offset = static_cast<DWORD>(segment->cursor & 0xFFFFFFFF);
+    position.OffsetHigh = static_cast<DWORD>(segment->cursor >> 32);
+
+    DWORD written = 0;
+
+    if (!WriteFile(segment->owner->file, data, static_cast<DWORD>(bytes), &written, &position) || written != bytes)
+    {
+        spdlog::error("Failed to write to {}, error {}",
+                      segment->owner->options.targetFile.string(), GetLastError());
+        return 0;
+    }
+
+    // the cursor is only ever moved here, but read by the owner and the other segments' callbacks
+    std::lock_guard guard(segment->owner->segmentLock);
+
+    const curl_off_t offset = segment->cursor;
+    segment->cursor += static_cast<curl_off_t>(bytes);
+    segment->lastActivity = std::chrono::steady_clock::now();
+
+    segment->owner->AdvanceHashPipeline(data, bytes, offset);
+
+    return bytes;
+}
+
+size_t net::Downloader::HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+    const auto* segment = static_cast<DownloadSegment*>(userdata);
+    const auto bytes = size * nitems;
+
+    if (const auto delay = RetryPolicy::ParseRetryAfterLine(std::string_view(buffer, bytes)); delay.has_value())
+    {
+        // other segments may still be receiving their headers
+        std::lock_guard guard(segment->owner->segmentLock);
+        segment->owner->retryAfter = delay;
+    }
+
+    return bytes;
+}
+
+void net::Downloader::RankCandidates()
+{
+    candidates = {options.url};
+    candidate = 0;
+
+    for (const auto& url : options.mirrorUrls)
+    {
+        if (std::ranges::find(candidates, url) == candidates.end())
+        {
+            candidates.push_back(url);
+        }
+    }
+
+    if (candidates.size() < 2)
+    {
+        return;
+    }
+
+    // only mirrors never measured before need a sample, the history covers the others
+    std::vector<std::string> unknown;
+
+    std::ranges::copy_if(candidates, std::back_inserter(unknown), [this](const std::string& url)
+    {
+        return options.history == nullptr || !options.history->IsMeasured(url);
+    });
+
+    if (unknown.empty())
+    {
+        options.history->RankByThroughput(candidates);
+        spdlog::debug("Ranked {} mirrors by throughput history, using {}", candidates.size(), candidates.front());
+        return;
+    }
+
+    // the first bytes of the payload tell about latency and speed of each mirror
+    constexpr curl_off_t sampleSize = 64 * 1024;
+
+    struct Sample
+    {
+        CURL* handle{nullptr};
+        curl_off_t received{0};
+        CURLcode result{CURLE_FAILED_INIT};
+        long statusCode{0};
+        curl_off_t speed{0};
+        std::chrono::microseconds elapsed{0};
+    };
+
+    auto writeCallback = [](char*, size_t size, size_t nmemb, void* userdata) -> size_t
+    {
+        auto* sample = static_cast<Sample*>(userdata);
+        sample->received += static_cast<curl_off_t>(size * nmemb);
+
+        // servers ignoring the range would send the whole payload
+        return sample->received > sampleSize ? 0 : size * nmemb;
+    };
+
+    auto& pool = ConnectionPool::Instance();
+    std::vector<Sample> samples(unknown.size());
+    std::vector<CURL*> active;
+    const auto range = std::format("0-{}", sampleSize - 1);
+
+    for (size_t index = 0; index < unknown.size(); index++)
+    {
+        auto& sample = samples[index];
+        sample.handle = pool.Acquire();
+
+        if (sample.handle == nullptr)
+        {
+            continue;
+        }
+
+        curl_easy_setopt(sample.handle, CURLOPT_URL, unknown[index].c_str());
+        curl_easy_setopt(sample.handle, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(sample.handle, CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(sample.handle, CURLOPT_USERAGENT, options.userAgent.c_str());
+        curl_easy_setopt(sample.handle, CURLOPT_HTTPHEADER, headerList);
+        curl_easy_setopt(sample.handle, CURLOPT_RANGE, range.c_str());
+        curl_easy_setopt(sample.handle, CURLOPT_CONNECTTIMEOUT, options.connectTimeout);
+        curl_easy_setopt(sample.handle, CURLOPT_TIMEOUT, options.connectTimeout + options.idleTimeout);
+        curl_easy_setopt(sample.handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(sample.handle, CURLOPT_WRITEFUNCTION, static_cast<curl_write_callback>(writeCallback));
+        curl_easy_setopt(sample.handle, CURLOPT_WRITEDATA, &sample);
+
+        pool.Start(sample.handle);
+        active.push_back(sample.handle);
+    }
+
+    while (!active.empty() && (options.isCancelled == nullptr || !options.isCancelled->load()))
+    {
+        if (const auto completed = pool.WaitAny(active, std::chrono::milliseconds(100)); completed.has_value())
+        {
+            const auto sample = std::ranges::find(samples, completed.value().first, &Sample::handle);
+            sample->result = completed.value().second;
+
+            std::erase(active, completed.value().first);
+        }
+    }
+
+    for (const auto handle : active)
+    {
+        pool.Abort(handle);
+    }
+
+    for (auto& sample : samples)
+    {
+        if (sample.handle == nullptr)
+        {
+            continue;
+        }
+
+        curl_easy_getinfo(sample.handle, CURLINFO_RESPONSE_CODE, &sample.statusCode);
+
+        curl_off_t elapsed = 0;
+        curl_easy_getinfo(sample.handle, CURLINFO_TOTAL_TIME_T, &elapsed);
+
+        // a whole payload cut short by us is as good as the requested range
+        const bool isValid = (sample.result == CURLE_OK && (sample.statusCode == 206 || sample.statusCode == 200)) ||
+            (sample.result == CURLE_WRITE_ERROR && sample.statusCode == 200);
+
+        if (isValid && elapsed > 0)
+        {
+            sample.speed = sample.received * 1000000 / elapsed;
+            sample.elapsed = std::chrono::microseconds(elapsed);
+        }
+
+        pool.Release(sample.handle);
+        sample.handle = nullptr;
+    }
+
+    const bool isCancelled = options.isCancelled != nullptr && options.isCancelled->load();
+
+    for (size_t index = 0; index < unknown.size(); index++)
+    {
+        spdlog::debug("Mirror {} answered with {} ({}) at {} bytes/s", unknown[index],
+                      samples[index].statusCode, magic_enum::enum_name(samples[index].result), samples[index].speed);
+    }
+
+    if (options.history != nullptr)
+    {
+        // samples are remembered like finished transfers, so the next run can skip them
+        for (size_t index = 0; index < unknown.size() && !isCancelled; index++)
+        {
+            const auto& sample = samples[index];
+
+            options.history->RecordThroughput(
+                unknown[index],
+                sample.speed > 0,
+                sample.speed > 0 ? sample.received : 0,
+                std::max(std::chrono::duration_cast<std::chrono::milliseconds>(sample.elapsed),
+                         std::chrono::milliseconds(1))
+            );
+        }
+
+        // the samples just taken and the remembered throughput of the others decide together
+        options.history->RankByThroughput(candidates);
+
+        spdlog::debug("Ranked {} mirrors by throughput, using {}", candidates.size(), candidates.front());
+        return;
+    }
+
+    std::vector<size_t> order(unknown.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::ranges::stable_sort(order, std::greater{}, [&samples](const size_t index)
+    {
+        return samples[index].speed;
+    });
+
+    std::vector<std::string> ranked;
+
+    for (const auto index : order)
+    {
+        ranked.push_back(unknown[index]);
+    }
+
+    candidates = std::move(ranked);
+}
+
+bool net::Downloader::Probe(bool& acceptsRanges)
+{
+    acceptsRanges = false;
+    effectiveUrl = sourceUrl;
+    etag.clear();
+    lastModified.clear();
+
+    auto& pool = ConnectionPool::Instance();
+    CURL* curl = pool.Acquire();
+
+    if (curl == nullptr)
+    {
+        return false;
+    }
+
+    struct ProbeHeaders
+    {
+        bool acceptsRanges{false};
+        std::string etag;
+        std::string lastModified;
+    } probe;
+
+    auto headerCallback = [](char* buffer, size_t size, size_t nitems, void* userdata) -> size_t
+    {
+        auto* headers = static_cast<ProbeHeaders*>(userdata);
+        const auto bytes = size * nitems;
+
+        // each new status line (e.g. after a redirect) resets what we know
+        if (bytes > 5 && std::string_view(buffer, 5) == "HTTP/")
+        {
+            *headers = ProbeHeaders{};
+            return bytes;
+        }
+
+        std::string name, value;
+
+        if (!util::ParseHeaderLine(buffer, bytes, name, value))
+        {
+            return bytes;
+        }
+
+        if (util::icompare(name, "Accept-Ranges"))
+        {
+            headers->acceptsRanges = util::icompare(value, "bytes");
+        }
+        else if (util::icompare(name, "ETag"))
+        {
+            headers->etag = value;
+        }
+        else if (util::icompare(name, "Last-Modified"))
+        {
+            headers->lastModified = value;
+        }
+
+        return bytes;
+    };
+
+    curl_easy_setopt(curl, CURLOPT_URL, sourceUrl.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, options.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connectTimeout);
+    // without a body there is nothing to measure the speed of, bound the whole request instead
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, options.connectTimeout + options.idleTimeout);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, static_cast<curl_write_callback>(headerCallback));
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &probe);
+
+    // shares the connection with other requests to the same HTTP/2 origin
+    const CURLcode result = pool.Perform(curl);
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+
+    if (result != CURLE_OK || code != 200)
+    {
+        // some servers do not like HEAD, the regular GET will tell
+        spdlog::warn("Probing {} failed with result {} and code {}",
+                     sourceUrl, magic_enum::enum_name(result), code);
+        pool.Release(curl);
+        return false;
+    }
+
+    acceptsRanges = probe.acceptsRanges;
+    etag = probe.etag;
+    lastModified = probe.lastModified;
+
+    curl_off_t contentLength = -1;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+
+    if (contentLength > 0)
+    {
+        totalSize = contentLength;
+    }
+
+    // skip the redirect chain on every segment request
+    if (char* url = nullptr; curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK && url != nullptr)
+    {
+        effectiveUrl = url;
+    }
+
+    spdlog::debug("effectiveUrl = {}, totalSize = {}, acceptsRanges = {}", effectiveUrl, totalSize, acceptsRanges);
+    spdlog::debug("etag = {}, lastModified = {}", etag, lastModified);
+
+    pool.Release(curl);
+    return true;
+}
+
+void net::Downloader::PlanSegments(const bool acceptsRanges)
+{
+    segments.clear();
+
+    // single stream without range request, can not be resumed
+    if (!acceptsRanges || totalSize <= 0)
+    {
+        segments.push_back({.begin = 0, .end = -1, .cursor = 0, .owner = this});
+        return;
+    }
+
+    const curl_off_t count = std::clamp<curl_off_t>(
+        totalSize / std::max<curl_off_t>(options.minSegmentSize, 1),
+        1,
+        std::max(options.maxConnections, 1)
+    );
+
+    const curl_off_t segmentSize = totalSize / count;
+
+    for (curl_off_t index = 0; index < count; index++)
+    {
+        const curl_off_t begin = index * segmentSize;
+        const curl_off_t end = index == count - 1 ? totalSize - 1 : begin + segmentSize - 1;
+
+        segments.push_back({.begin = begin, .end = end, .cursor = begin, .owner = this});
+    }
+
+    spdlog::debug("Splitting download into {} segments of ~{} bytes", count, segmentSize);
+}
+
+bool net::Downloader::TryResume(const bool acceptsRanges)
+{
+    const auto& state = options.resumeState.value();
+
+    if (!acceptsRanges || state.totalSize != totalSize || GetIfRangeValidator().empty())
+    {
+        spdlog::info("Partial download of {} can not be resumed", options.url);
+        return false;
+    }
+
+    // validators differ between mirrors, only the checksum proves they serve the same file
+    if (const auto& stateSource = state.sourceUrl.empty() ? state.url : state.sourceUrl; stateSource != sourceUrl)
+    {
+        if (options.checksum.empty())
+        {
+            spdlog::info("Partial download of {} came from another mirror, restarting download", options.url);
+            return false;
+        }
+    }
+    else if (state.etag != etag || state.lastModified != lastModified)
+    {
+        spdlog::info("Remote file {} has changed, restarting download", options.url);
+        return false;
+    }
+
+    segments.clear();
+
+    for (const auto& [begin, end, cursor] : state.segments)
+    {
+        // never trust what's on disk blindly
+        if (begin < 0 || end >= totalSize || cursor < begin || cursor > end + 1)
+        {
+            spdlog::warn("Discarding invalid download state");
+            segments.clear();
+            return false;
+        }
+
+        segments.push_back({.begin = begin, .end = end, .cursor = cursor, .owner = this});
+    }
+
+    return !segments.empty();
+}
+
+bool net::Downloader::OpenTargetFile(const bool keepContents)
+{
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+
+    file = CreateFileA(
+        options.targetFile.string().c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ,
+        nullptr,
+        keepContents ? OPEN_EXISTING : CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        spdlog::error("Failed to open file {}, error {}", options.targetFile.string(), GetLastError());
+        return false;
+    }
+
+    if (keepContents)
+    {
+        LARGE_INTEGER size{};
+
+        // the partial file must still have the size we left it with
+        if (!GetFileSizeEx(file, &size) || size.QuadPart != totalSize)
+        {
+            spdlog::warn("Partial file {} has unexpected size", options.targetFile.string());
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            return false;
+        }
+
+        return true;
+    }
+
+    // reserve the space upfront so segments written out of order don't fragment the file
+    if (totalSize > 0)
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = totalSize;
+
+        if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+        {
+            spdlog::warn("Failed to pre-allocate {} bytes, error {}", totalSize, GetLastError());
+        }
+    }
+
+    return true;
+}
+
+CURL* net::Downloader::CreateTransfer(DownloadSegment& segment) const
+{
+    CURL* curl = ConnectionPool::Instance().Acquire();
+
+    if (curl == nullptr)
+    {
+        return nullptr;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, effectiveUrl.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, options.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    // large payloads on slow links take however long they take, only give up on stalled ones
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connectTimeout);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, options.lowSpeedLimit);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, options.lowSpeedTime);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &segment);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &segment);
+
+    if (segment.IsRanged())
+    {
+        const auto range = std::format("{}-{}", segment.cursor, segment.end);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+    }
+
+    segment.handle = curl;
+    segment.statusCode = 0;
+    segment.isRejected = false;
+    segment.lastActivity = std::chrono::steady_clock::now();
+
+    return curl;
+}
+
+int net::Downloader::Transfer()
+{
+    auto& pool = ConnectionPool::Instance();
+
+    {
+        std::lock_guard guard(segmentLock);
+        retryAfter.reset();
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const auto GetReceived = [this]()
+    {
+        std::lock_guard guard(segmentLock);
+        curl_off_t received = 0;
+
+        for (const auto& segment : segments)
+        {
+            received += segment.cursor - segment.begin;
+        }
+
+        return received;
+    };
+    const curl_off_t receivedBefore = GetReceived();
+
+    int result = 200;
+    // the segments' transfers in flight, they share the pool's multi handle with all other requests
+    std::vector<CURL*> active;
+
+    for (auto& segment : segments)
+    {
+        if (segment.IsComplete())
+        {
+            continue;
+        }
+
+        if (CreateTransfer(segment) == nullptr)
+        {
+            result = CURLE_FAILED_INIT;
+            break;
+        }
+
+        pool.Start(segment.handle);
+        active.push_back(segment.handle);
+    }
+
+    while (result == 200 && !active.empty())
+    {
+        if (const auto completed = pool.WaitAny(active, std::chrono::milliseconds(250)); completed.has_value())
+        {
+            const auto [handle, code] = completed.value();
+            std::erase(active, handle);
+
+            const auto segment = std::ranges::find(segments, handle, &DownloadSegment::handle);
+
+            // the transfer is over, its callbacks won't write to the segment anymore
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &segment->statusCode);
+
+            // the other segments are wasted as well, Run starts over with a single stream
+            if (segment->IsRanged() && segment->statusCode == 200)
+            {
+                rangesRejected = true;
+                result = CURLE_RANGE_ERROR;
+            }
+            else if (code != CURLE_OK && !segment->isRejected)
+            {
+                spdlog::error("Segment {}-{} failed with {}",
+                              segment->begin, segment->end, magic_enum::enum_name(code));
+                result = code;
+            }
+            else if (segment->statusCode != (segment->IsRanged() ? 206 : 200))
+            {
+                result = segment->statusCode;
+            }
+            else if (segment->IsRanged() && !segment->IsComplete())
+            {
+                spdlog::error("Segment {}-{} ended early at {}", segment->begin, segment->end, segment->cursor);
+                result = CURLE_PARTIAL_FILE;
+            }
+
+            pool.Release(handle);
+            segment->handle = nullptr;
+        }
+
+        if (options.progressFn != nullptr)
+        {
+            curl_off_t total = totalSize;
+            curl_off_t downloaded = 0;
+
+            {
+                std::lock_guard guard(segmentLock);
+
+                for (const auto& segment : segments)
+                {
+                    downloaded += segment.cursor - segment.begin;
+
+                    if (total < 0 && segment.handle != nullptr)
+                    {
+                        total = segment.contentLength;
+                    }
+                }
+            }
+
+            if (options.progressFn(nullptr, static_cast<double>(std::max<curl_off_t>(total, 0)),
+                                   static_cast<double>(downloaded), 0, 0) != 0)
+            {
+                result = CURLE_ABORTED_BY_CALLBACK;
+            }
+        }
+
+        // the low speed limit tolerates a trickle, this catches connections that went entirely silent
+        if (options.idleTimeout > 0)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            std::lock_guard guard(segmentLock);
+
+            for (const auto& segment : segments)
+            {
+                if (segment.handle != nullptr && now - segment.lastActivity > std::chrono::seconds(options.idleTimeout))
+                {
+                    spdlog::error("Segment {}-{} stalled at {}, no data for {} seconds",
+                                  segment.begin, segment.end, segment.cursor, options.idleTimeout);
+                    result = CURLE_OPERATION_TIMEDOUT;
+                    break;
+                }
+            }
+        }
+
+        if (options.isCancelled != nullptr && options.isCancelled->load())
+        {
+            spdlog::info("Download cancelled");
+            result = CURLE_ABORTED_BY_CALLBACK;
+        }
+
+        if (result == 200 && std::chrono::steady_clock::now() - lastCheckpoint > std::chrono::seconds(2))
+        {
+            SaveState();
+        }
+    }
+
+    // tear down whatever is left after a failure
+    for (auto& segment : segments)
+    {
+        if (segment.handle != nullptr)
+        {
+            pool.Abort(segment.handle);
+            pool.Release(segment.handle);
+            segment.handle = nullptr;
+        }
+    }
+
+    // neither the user cancelling nor the mirror not supporting ranges say anything about its speed
+    if (options.history != nullptr && result != CURLE_ABORTED_BY_CALLBACK && !rangesRejected)
+    {
+        options.history->RecordThroughput(
+            sourceUrl,
+            result == 200,
+            GetReceived() - receivedBefore,
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started)
+        );
+    }
+
+    // keep what we got so far for the next attempt
+    if (result != 200)
+    {
+        SaveState();
+    }
+
+    return result;
+}
+
+void net::Downloader::BuildHeaderList(const bool acceptsRanges)
+{
+    if (headerList != nullptr)
+    {
+        curl_slist_free_all(headerList);
+        headerList = nullptr;
+    }
+
+    for (const auto& [name, value] : options.headers)
+    {
+        headerList = curl_slist_append(headerList, std::format("{}: {}", name, value).c_str());
+    }
+
+    // ranges only get served if the remote file still matches what we've seen during probing
+    if (const auto validator = GetIfRangeValidator(); acceptsRanges && !validator.empty())
+    {
+        headerList = curl_slist_append(headerList, std::format("If-Range: {}", validator).c_str());
+    }
+}
+
+bool net::Downloader::FailOver(const int code)
+{
+    if (candidate + 1 >= candidates.size() || !RetryPolicy::IsRetryable(code) ||
+        (options.isCancelled != nullptr && options.isCancelled->load()))
+    {
+        return false;
+    }
+
+    const bool hasProgress = std::ranges::any_of(segments, [](const DownloadSegment& segment)
+    {
+        return segment.cursor > segment.begin;
+    });
+
+    // bytes of different mirrors may only be combined if the result gets verified
+    if (hasProgress && options.checksum.empty())
+    {
+        spdlog::warn("Can not continue download on another mirror without a checksum");
+        return false;
+    }
+
+    const curl_off_t knownSize = totalSize;
+
+    while (++candidate < candidates.size())
+    {
+        sourceUrl = candidates[candidate];
+        totalSize = -1;
+
+        bool acceptsRanges = false;
+
+        if (!Probe(acceptsRanges) && hasProgress)
+        {
+            continue;
+        }
+
+        if (hasProgress)
+        {
+            if (!acceptsRanges || totalSize <= 0 || (knownSize > 0 && totalSize != knownSize))
+            {
+                spdlog::warn("Mirror {} can not continue the partial download", sourceUrl);
+                continue;
+            }
+
+            // a single stream picks up at its cursor with a range request
+            if (!segments.front().IsRanged())
+            {
+                segments.front().end = totalSize - 1;
+            }
+        }
+        else
+        {
+            if (totalSize < 0)
+            {
+                totalSize = knownSize;
+            }
+
+            PlanSegments(acceptsRanges);
+
+            if (!OpenTargetFile(false))
+            {
+                return false;
+            }
+
+            ResetHashPipeline();
+        }
+
+        BuildHeaderList(acceptsRanges);
+        SaveState();
+
+        spdlog::warn("Continuing download from mirror {}", sourceUrl);
+        return true;
+    }
+
+    totalSize = knownSize;
+    return false;
+}
+
+std::string net::Downloader::GetIfRangeValidator() const
+{
+    // weak validators are not allowed in If-Range
+    if (!etag.empty() && !etag.starts_with("W/"))
+    {
+        return etag;
+    }
+
+    return lastModified;
+}
+
+void net::Downloader::SaveState()
+{
+    lastCheckpoint = std::chrono::steady_clock::now();
+
+    if (options.stateFile.empty())
+    {
+        return;
+    }
+
+    // a single stream can not be resumed, don't leave anything misleading behind
+    if (segments.empty() || !segments.front().IsRanged())
+    {
+        std::error_code ec;
+        std::filesystem::remove(options.stateFile, ec);
+        return;
+    }
+
+    models::DownloadState state;
+
+    // taken before flushing, everything up to the cursors has been written by then
+    {
+        std::lock_guard guard(segmentLock);
+
+        for (const auto& segment : segments)
+        {
+            state.segments.push_back({segment.begin, segment.end, segment.cursor});
+        }
+    }
+
+    // the state must never claim bytes that didn't make it to the disk yet
+    if (!FlushFileBuffers(file))
+    {
+        spdlog::warn("Failed to flush {}, error {}", options.targetFile.string(), GetLastError());
+        return;
+    }
+
+    state.url = options.url;
+    state.sourceUrl = sourceUrl;
+    state.etag = etag;
+    state.lastModified = lastModified;
+    state.totalSize = totalSize;
+    state.tempFile = options.targetFile.string();
+
+    try
+    {
+        const auto content = json(state).dump();
+
+        util::WriteFileAtomically(options.stateFile, content.data(), content.size());
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("Failed to persist download state, error {}", e.what());
+    }
+}
+
+void net::Downloader::ResetHashPipeline()
+{
+    hashPipeline.reset();
+    hashFrontier = 0;
+
+    if (options.checksum.empty())
+    {
+        return;
+    }
+
+    hashPipeline = std::make_unique<hashing::HashPipeline>(options.checksumAlg, options.targetFile);
+
+    if (!hashPipeline->IsValid())
+    {
+        spdlog::error("Unsupported checksum algorithm {}", magic_enum::enum_name(options.checksumAlg));
+        return;
+    }
+
+    // a resumed download already has parts on disk
+    AdvanceHashPipeline(nullptr, 0, -1);
+}
+
+void net::Downloader::AdvanceHashPipeline(const char* data, const size_t length, const curl_off_t offset)
+{
+    if (hashPipeline == nullptr || !hashPipeline->IsValid())
+    {
+        return;
+    }
+
+    // the common case, the stream right at the frontier hands over what it just received
+    if (offset == hashFrontier && length > 0)
+    {
+        hashPipeline->Push(data, length, offset);
+        hashFrontier += static_cast<curl_off_t>(length);
+    }
+
+    // other segments may already have written the bytes following the frontier
+    bool hasAdvanced = true;
+
+    while (hasAdvanced)
+    {
+        hasAdvanced = false;
+
+        for (const auto& segment : segments)
+        {
+            if (segment.begin <= hashFrontier && hashFrontier < segment.cursor)
+            {
+                hashPipeline->PushFileRange(hashFrontier, segment.cursor - hashFrontier);
+                hashFrontier = segment.cursor;
+                hasAdvanced = true;
+            }
+        }
+    }
+}
+
+void net::Downloader::VerifyChecksum()
+{
+    if (options.checksum.empty())
+    {
+        isChecksumValid.reset();
+        return;
+    }
+
+    isChecksumValid = false;
+
+    std::vector<uint8_t> expected;
+
+    if (!hashing::ParseHexDigest(util::trim(options.checksum), expected))
+    {
+        spdlog::error("Expected checksum {} is not a valid hex string", options.checksum);
+        return;
+    }
+
+    if (hashPipeline == nullptr || !hashPipeline->IsValid())
+    {
+        return;
+    }
+
+    const auto digest = hashPipeline->Finish();
+
+    if (!digest.has_value())
+    {
+        spdlog::error("Failed to calculate checksum of {}", options.targetFile.string());
+        return;
+    }
+
+    isChecksumValid = digest.value() == expected;
+
+    if (!isChecksumValid.value())
+    {
+        spdlog::error("Checksum mismatch, expected {} but got {}",
+                      options.checksum, hashing::ToHexDigest(digest.value()));
+    }
+    else
+    {
+        spdlog::info("Checksum {} verified", hashing::ToHexDigest(digest.value()));
+    }
+}
+
+std::optional<models::DownloadState> net::Downloader::LoadState(const std::filesystem::path& stateFile)
+{
+    std::error_code ec;
+
+    if (!exists(stateFile, ec))
+    {
+        return std::nullopt;
+    }
+
+    try
+    {
+        std::ifstream stream(stateFile);
+
+        return json::parse(stream).get<models::DownloadState>();
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("Failed to read download state {}, error {}", stateFile.string(), e.what());
+        return std::nullopt;
+    }
+}
+
+void net::Downloader::Cleanup()
+{
+    if (headerList != nullptr)
+    {
+        curl_slist_free_all(headerList);
+        headerList = nullptr;
+    }
+
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+}
+
+int net::Downloader::Run()
+{
+    BuildHeaderList(false);
+    RankCandidates();
+
+    sourceUrl = candidates.front();
+
+    bool acceptsRanges = false;
+
+    Probe(acceptsRanges);
+
+    if (totalSize < 0 && options.expectedSize.has_value())
+    {
+        totalSize = static_cast<curl_off_t>(options.expectedSize.value());
+    }
+
+    BuildHeaderList(acceptsRanges);
+
+    bool isResuming = options.resumeState.has_value() && TryResume(acceptsRanges);
+
+    if (isResuming && !OpenTargetFile(true))
+    {
+        isResuming = false;
+    }
+
+    if (isResuming)
+    {
+        spdlog::info("Resuming download of {}", options.url);
+    }
+    else
+    {
+        PlanSegments(acceptsRanges);
+
+        if (!OpenTargetFile(false))
+        {
+            return -1;
+        }
+    }
+
+    // replaces any stale state of an earlier attempt
+    SaveState();
+    ResetHashPipeline();
+
+    int code = Transfer();
+
+    // a mirror breaking down hands its remaining ranges to the next best one
+    while (code != 200 && !rangesRejected && FailOver(code))
+    {
+        code = Transfer();
+    }
+
+    // server ignored the range or the file changed since probing, start over with one stream
+    if (rangesRejected)
+    {
+        spdlog::warn("Server ignored range request, falling back to single stream");
+
+        rangesRejected = false;
+        PlanSegments(false);
+
+        if (!OpenTargetFile(false))
+        {
+            return -1;
+        }
+
+        SaveState();
+        ResetHashPipeline();
+
+        code = Transfer();
+    }
+
+    // the size might have been a guess, cut off what the stream didn't fill
+    if (code == 200 && !segments.front().IsRanged())
+    {
+        LARGE_INTEGER size;
+        size.QuadPart = segments.front().cursor;
+
+        SetFilePointerEx(file, size, nullptr, FILE_BEGIN);
+        SetEndOfFile(file);
+    }
+
+    if (code == 200)
+    {
+        VerifyChecksum();
+    }
+
+    hashPipeline.reset();
+    Cleanup();
+
+    if (code == 200 && !options.stateFile.empty())
+    {
+        std::error_code ec;
+        std::filesystem::remove(options.stateFile, ec);
+    }
+
+    return code;
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <curl/curl.h>
+
+#include "DownloadState.hpp"
+#include "Hashing.hpp"
+#include "RetryPolicy.hpp"
+#include "MirrorHistory.hpp"
+
+
+namespace net
+{
+    /**
+     * \brief A byte range of the remote payload fetched by its own transfer.
+     * \remarks The transfers run on the connection pool's worker thread, whatever they update while
+     *          in flight is guarded by the owner's segment lock.
+     */
+    struct DownloadSegment
+    {
+        /** Offset of the first byte of this segment */
+        curl_off_t begin{0};
+        /** Offset of the last byte of this segment (inclusive), -1 if the size is unknown */
+        curl_off_t end{-1};
+        /** Offset of the next byte to write */
+        curl_off_t cursor{0};
+        /** The transfer handle while this segment is active */
+        CURL* handle{nullptr};
+        /** The HTTP status code of the last response */
+        long statusCode{0};
+        /** True if the server didn't answer with the expected status code */
+        bool isRejected{false};
+        /** When data was last received, used to detect stalled transfers */
+        std::chrono::steady_clock::time_point lastActivity;
+        /** The body size announced by the server, -1 if unknown */
+        curl_off_t contentLength{-1};
+        /** Back-reference used in the write callback */
+        class Downloader* owner{nullptr};
+
+        [[nodiscard]] bool IsRanged() const { return end >= 0; }
+        [[nodiscard]] bool IsComplete() const { return IsRanged() && cursor > end; }
+    };
+
+    /**
+     * \brief Parameters of a single payload download.
+     */
+    struct DownloadOptions
+    {
+        /** The remote payload URL */
+        std::string url;
+        /** Further URLs serving the identical payload */
+        std::vector<std::string> mirrorUrls;
+        /** Remembered mirror throughput, used for ranking and updated with the outcome, may be nullptr */
+        models::MirrorHistory* history{nullptr};
+        /** The local file the payload gets written to */
+        std::filesystem::path targetFile;
+        /** The User Agent string to send */
+        std::string userAgent;
+        /** Additional request headers */
+        std::map<std::string, std::string> headers;
+        /** The payload size, if known from the update response */
+        std::optional<size_t> expectedSize;
+        /** Seconds to wait for a connection to be established */
+        long connectTimeout{NV_DOWNLOAD_CONNECT_TIMEOUT};
+        /** Transfers slower than this many bytes per second for lowSpeedTime seconds are aborted */
+        long lowSpeedLimit{NV_DOWNLOAD_LOW_SPEED_LIMIT};
+        /** The window in seconds lowSpeedLimit is measured over */
+        long lowSpeedTime{NV_DOWNLOAD_LOW_SPEED_TIME};
+        /** Seconds without any data received after which a transfer is aborted */
+        long idleTimeout{NV_DOWNLOAD_IDLE_TIMEOUT};
+        /** Maximum number of parallel ranges, and thereby of HTTP/1.1 connections */
+        int maxConnections{NV_DOWNLOAD_MAX_CONNECTIONS};
+        /** Payloads smaller than twice this size are fetched with one connection */
+        curl_off_t minSegmentSize{NV_DOWNLOAD_MIN_SEGMENT_SIZE};
+        /** Receives the aggregated progress of all segments */
+        curl_progress_callback progressFn{nullptr};
+        /** Where to persist progress so a later run can resume, empty to disable */
+        std::filesystem::path stateFile;
+        /** Progress of an earlier attempt on the same target file, if any */
+        std::optional<models::DownloadState> resumeState;
+        /** Set by the owner to abort the transfer */
+        const std::atomic<bool>* isCancelled{nullptr};
+        /** The expected checksum (hex) of the payload, empty to skip verification */
+        std::string checksum;
+        /** The algorithm the checksum was calculated with */
+        models::ChecksumAlgorithm checksumAlg{models::ChecksumAlgorithm::Invalid};
+    };
+
+    /**
+     * \brief Downloads a payload in parallel byte ranges if the server supports it, with one stream otherwise.
+     * \remarks The ranges run on the connection pool's multi handle. An HTTP/2 server gets them as
+     *          streams of one connection, over HTTP/1.1 each range opens a connection of its own, so
+     *          maxConnections bounds the connections per origin there.
+     */
+    class Downloader
+    {
+        DownloadOptions options;
+        /** The payload URL and its mirrors, fastest first */
+        std::vector<std::string> candidates;
+        /** Index of the candidate currently downloaded from */
+        size_t candidate{0};
+        /** The candidate currently downloaded from */
+        std::string sourceUrl;
+        /** URL after following redirects, used by all segments */
+        std::string effectiveUrl;
+        /** The full payload size or -1 if unknown */
+        curl_off_t totalSize{-1};
+        /** The ETag validator reported by the server */
+        std::string etag;
+        /** The Last-Modified validator reported by the server */
+        std::string lastModified;
+        /** When progress was last persisted */
+        std::chrono::steady_clock::time_point lastCheckpoint;
+        HANDLE file{INVALID_HANDLE_VALUE};
+        curl_slist* headerList{nullptr};
+        std::vector<DownloadSegment> segments;
+        /** Guards the progress of the segments, the hash pipeline and retryAfter while transfers are in flight */
+        mutable std::mutex segmentLock;
+        /** True if the server ignored a range request and the download must use one stream */
+        bool rangesRejected{false};
+        /** Hashes the payload while it's being written */
+        std::unique_ptr<hashing::HashPipeline> hashPipeline;
+        /** Offset up to which the payload has been handed to the hash pipeline */
+        curl_off_t hashFrontier{0};
+        /** Outcome of the checksum verification, empty if not requested */
+        std::optional<bool> isChecksumValid;
+        /** The delay requested by the server with the last failed response, if any */
+        std::optional<std::chrono::seconds> retryAfter;
+
+        static size_t WriteCallback(char* data, size_t size, size_t nmemb, void* userdata);
+        static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata);
+
+        void RankCandidates();
+        bool Probe(bool& acceptsRanges);
+        void BuildHeaderList(bool acceptsRanges);
+        bool FailOver(int code);
+        void PlanSegments(bool acceptsRanges);
+        bool TryResume(bool acceptsRanges);
+        bool OpenTargetFile(bool keepContents);
+        [[nodiscard]] std::string GetIfRangeValidator() const;
+        void SaveState();
+        void ResetHashPipeline();
+        void AdvanceHashPipeline(const char* data, size_t length, curl_off_t offset);
+        void VerifyChecksum();
+        CURL* CreateTransfer(DownloadSegment& segment) const;
+        int Transfer();
+        void Cleanup();
+
+    public:
+        explicit Downloader(DownloadOptions options);
+
+        Downloader(const Downloader&) = delete;
+        Downloader(Downloader&&) = delete;
+        Downloader& operator=(const Downloader&) = delete;
+        Downloader& operator=(Downloader&&) = delete;
+
+        ~Downloader();
+
+        /**
+         * \brief Runs the download to completion.
+         * \return The HTTP status code (200 on success) or a CURLcode on transport errors.
+         */
+        [[nodiscard]] int Run();
+
+        /**
+         * \brief Result of the inline checksum verification, available once Run succeeded.
+         * \return True if the checksum matched, false on mismatch, empty if none was requested.
+         */
+        [[nodiscard]] std::optional<bool> IsChecksumValid() const { return isChecksumValid; }
+
+        /**
+         * \brief The delay the server asked for when rejecting the last attempt (429 or 503), if any.
+         */
+        [[nodiscard]] std::optional<std::chrono::seconds> GetRetryAfter() const
+        {
+            std::lock_guard guard(segmentLock);
+            return retryAfter;
+        }
+
+        /**
+         * \brief Reads the persisted progress of an earlier, unfinished download.
+         * \param stateFile Full pathname of the state file.
+         * \return The state, if any was found and could be read.
+         */
+        static std::optional<models::DownloadState> LoadState(const std::filesystem::path& stateFile);
+    };
+}
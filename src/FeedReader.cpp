@@ -0,0 +1,1038 @@
+#include "pch.h"
+#include "Common.h"
+#include "FeedReader.hpp"
+#include "ConnectionPool.hpp"
+
+#include <zlib.h>
+#include <zstd.h>
+
+
+namespace
+{
+    /** Maximum number of received chunks waiting for the parser before the transfer is throttled */
+    constexpr size_t MaxQueuedChunks = 64;
+
+    /** Size of the output window of the decompressors */
+    constexpr size_t DecodeBufferSize = 64 * 1024;
+
+    /** Receives decompressed data, returns false to abort */
+    using DecodeSink = std::function<bool(const char*, size_t)>;
+
+    /**
+     * \brief Undoes the compression of a precompressed file while it's being received.
+     */
+    class BodyDecoder
+    {
+    public:
+        virtual ~BodyDecoder() = default;
+
+        /**
+         * \brief Decompresses the next chunk of input.
+         * \return False if the input is corrupt or the sink refused the output.
+         */
+        virtual bool Decode(const char* data, size_t length, const DecodeSink& sink) = 0;
+
+        /**
+         * \brief True if the end of the compressed stream has been reached.
+         */
+        [[nodiscard]] virtual bool IsComplete() const = 0;
+    };
+
+    class GzipDecoder final : public BodyDecoder
+    {
+        z_stream stream{};
+        bool isInitialized{false};
+        bool isComplete{false};
+        std::vector<char> output = std::vector<char>(DecodeBufferSize);
+
+    public:
+        GzipDecoder()
+        {
+            // only accept the gzip wrapper
+            isInitialized = inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK;
+        }
+
+        ~GzipDecoder() override
+        {
+            if (isInitialized)
+            {
+                inflateEnd(&stream);
+            }
+        }
+
+        GzipDecoder(const GzipDecoder&) = delete;
+        GzipDecoder& operator=(const GzipDecoder&) = delete;
+
+        bool Decode(const char* data, const size_t length, const DecodeSink& sink) override
+        {
+            if (!isInitialized)
+            {
+                return false;
+            }
+
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            stream.avail_in = static_cast<uInt>(length);
+
+            // trailing garbage after the end of the stream is ignored
+            while (!isComplete)
+            {
+                stream.next_out = reinterpret_cast<Bytef*>(output.data());
+                stream.avail_out = static_cast<uInt>(output.size());
+
+                const int status = inflate(&stream, Z_NO_FLUSH);
+
+                if (status == Z_STREAM_END)
+                {
+                    isComplete = true;
+                }
+                // no progress possible, more input needed
+                else if (status == Z_BUF_ERROR)
+                {
+                    break;
+                }
+                else if (status != Z_OK)
+                {
+                    return false;
+                }
+
+                if (const size_t produced = output.size() - stream.avail_out;
+                    produced > 0 && !sink(output.data(), produced))
+                {
+                    return false;
+                }
+
+                if (stream.avail_in == 0 && stream.avail_out != 0)
+                {
+                    break;
+                }
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] bool IsComplete() const override { return isComplete; }
+    };
+
+    class ZstdDecoder final : public BodyDecoder
+    {
+        ZSTD_DStream* stream{ZSTD_createDStream()};
+        bool isFrameComplete{false};
+        std::vector<char> output = std::vector<char>(DecodeBufferSize);
+
+    public:
+        ~ZstdDecoder() override
+        {
+            ZSTD_freeDStream(stream);
+        }
+
+        ZstdDecoder() = default;
+        ZstdDecoder(const ZstdDecoder&) = delete;
+        ZstdDecoder& operator=(const ZstdDecoder&) = delete;
+
+        bool Decode(const char* data, const size_t length, const DecodeSink& sink) override
+        {
+            if (stream == nullptr)
+            {
+                return false;
+            }
+
+            ZSTD_inBuffer input{data, length, 0};
+
+            while (true)
+            {
+                ZSTD_outBuffer window{output.data(), output.size(), 0};
+
+                const size_t status = ZSTD_decompressStream(stream, &window, &input);
+
+                if (ZSTD_isError(status))
+                {
+                    return false;
+                }
+
+                // 0 means a frame has been decoded and flushed completely
+                isFrameComplete = status == 0;
+
+                if (window.pos > 0 && !sink(output.data(), window.pos))
+                {
+                    return false;
+                }
+
+                if (input.pos == input.size && window.pos < window.size)
+                {
+                    break;
+                }
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] bool IsComplete() const override { return isFrameComplete; }
+    };
+
+    std::unique_ptr<BodyDecoder> CreateDecoder(const net::FeedCompression compression)
+    {
+        switch (compression)
+        {
+        case net::FeedCompression::Gzip:
+            return std::make_unique<GzipDecoder>();
+        case net::FeedCompression::Zstd:
+            return std::make_unique<ZstdDecoder>();
+        case net::FeedCompression::None:
+            break;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * \brief Separates the query and fragment from the rest of the URL.
+     */
+    std::pair<std::string_view, std::string_view> SplitUrlPath(const std::string_view url)
+    {
+        const auto end = url.find_first_of("?#");
+
+        return end == std::string_view::npos
+                   ? std::make_pair(url, std::string_view{})
+                   : std::make_pair(url.substr(0, end), url.substr(end));
+    }
+
+    /**
+     * \brief The file name extension of the last URL path segment, including the dot.
+     */
+    std::string GetUrlExtension(const std::string_view url)
+    {
+        const auto path = SplitUrlPath(url).first;
+        const auto schemeEnd = path.find("://");
+        const auto segmentStart = path.find_last_of('/');
+
+        // a bare host name isn't a file
+        if (segmentStart == std::string_view::npos ||
+            (schemeEnd != std::string_view::npos && segmentStart < schemeEnd + 3))
+        {
+            return {};
+        }
+
+        const auto segment = path.substr(segmentStart + 1);
+        const auto dot = segment.find_last_of('.');
+
+        return dot == std::string_view::npos || dot == 0 ? std::string{} : std::string(segment.substr(dot));
+    }
+
+    std::string_view GetCompressionSuffix(const net::FeedCompression compression)
+    {
+        switch (compression)
+        {
+        case net::FeedCompression::Gzip:
+            return ".gz";
+        case net::FeedCompression::Zstd:
+            return ".zst";
+        case net::FeedCompression::None:
+            break;
+        }
+
+        return {};
+    }
+
+    /**
+     * \brief Determines the encoding of a precompressed file from its name, e.g. "updates.cbor.zst".
+     */
+    net::FeedEncoding GetPrecompressedEncoding(const std::string_view url, const net::FeedCompression compression)
+    {
+        auto path = SplitUrlPath(url).first;
+        const auto suffix = GetCompressionSuffix(compression);
+
+        if (path.ends_with(suffix))
+        {
+            path.remove_suffix(suffix.size());
+        }
+
+        const auto extension = GetUrlExtension(path);
+
+        if (util::icompare(extension, ".cbor"))
+        {
+            return net::FeedEncoding::Cbor;
+        }
+
+        if (util::icompare(extension, ".msgpack") || util::icompare(extension, ".mpk"))
+        {
+            return net::FeedEncoding::MessagePack;
+        }
+
+        return net::FeedEncoding::Json;
+    }
+
+    /**
+     * \brief Looks up a response header, names are case-insensitive.
+     */
+    std::string_view GetHeaderValue(const std::map<std::string, std::string>& headers, const std::string& name)
+    {
+        const auto header = std::ranges::find_if(headers, [&name](const auto& entry)
+        {
+            return util::icompare(entry.first, name);
+        });
+
+        return header == headers.end() ? std::string_view{} : std::string_view(header->second);
+    }
+
+    /**
+     * \brief Stream buffer fed by the network thread and drained by the parser thread.
+     */
+    class ChunkStreamBuffer final : public std::streambuf
+    {
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<std::string> chunks;
+        std::string current;
+        bool isClosed{false};
+        bool isAbandoned{false};
+
+    protected:
+        int_type underflow() override
+        {
+            std::unique_lock guard(lock);
+            changed.wait(guard, [this] { return !chunks.empty() || isClosed; });
+
+            if (chunks.empty())
+            {
+                return traits_type::eof();
+            }
+
+            current = std::move(chunks.front());
+            chunks.pop_front();
+            changed.notify_all();
+
+            setg(current.data(), current.data(), current.data() + current.size());
+
+            return traits_type::to_int_type(*gptr());
+        }
+
+    public:
+        /**
+         * \brief Queues received bytes, waits if the parser has fallen too far behind.
+         * \return False if the parser doesn't accept any more input.
+         */
+        bool Push(const char* data, const size_t length)
+        {
+            std::unique_lock guard(lock);
+            changed.wait(guard, [this] { return chunks.size() < MaxQueuedChunks || isAbandoned; });
+
+            if (isAbandoned)
+            {
+                return false;
+            }
+
+            chunks.emplace_back(data, length);
+            changed.notify_all();
+
+            return true;
+        }
+
+        /**
+         * \brief Signals the end of the input.
+         */
+        void Close()
+        {
+            std::lock_guard guard(lock);
+            isClosed = true;
+            changed.notify_all();
+        }
+
+        /**
+         * \brief Signals that the parser has stopped reading.
+         */
+        void Abandon()
+        {
+            std::lock_guard guard(lock);
+            isAbandoned = true;
+            chunks.clear();
+            changed.notify_all();
+        }
+    };
+
+    /**
+     * \brief SAX handler deserializing the update information directly into the models.
+     * \remarks Small nested objects (exit codes, detection parameters) are collected into a temporary
+     *          value and converted with the regular from_json functions. Each release is collected the
+     *          same way and handed to the release index, which keeps it in encoded form.
+     */
+    class UpdateResponseReader final : public nlohmann::json_sax<json>
+    {
+        enum class Section
+        {
+            None,
+            Root,
+            Instance,
+            Shared,
+            Releases,
+            Done
+        };
+
+        models::UpdateResponse& response;
+        Section section{Section::None};
+        /** Key of the value about to be read in the current section */
+        std::string currentKey;
+        /** Containers of the value currently being collected, innermost last */
+        std::vector<json*> collecting;
+        /** Key of the value about to be read in the innermost collected object */
+        std::string collectingKey;
+        /** The value currently being collected */
+        json collected;
+
+        template <typename T>
+        static void AssignTo(std::optional<T>& target, json& value)
+        {
+            target = value.get<T>();
+        }
+
+        static void AssignTo(std::string& target, json& value)
+        {
+            // takes over the parsed buffer instead of copying it
+            target = std::move(value.get_ref<std::string&>());
+        }
+
+        static void AssignTo(std::optional<std::string>& target, json& value)
+        {
+            AssignTo(target.emplace(), value);
+        }
+
+        /**
+         * \brief Stores a complete value in the model field the current section and key refer to.
+         */
+        void Assign(json&& value)
+        {
+            // absent and null are the same to us
+            if (value.is_null())
+            {
+                return;
+            }
+
+            switch (section)
+            {
+            case Section::Instance:
+                {
+                    auto& instance = response.instance.value();
+
+                    if (currentKey == "updatesDisabled") AssignTo(instance.updatesDisabled, value);
+                    else if (currentKey == "latestVersion") AssignTo(instance.latestVersion, value);
+                    else if (currentKey == "latestUrl") AssignTo(instance.latestUrl, value);
+                    else if (currentKey == "latestChecksum") AssignTo(instance.latestChecksum, value);
+                    else if (currentKey == "emergencyUrl") AssignTo(instance.emergencyUrl, value);
+                    else if (currentKey == "exitCode") AssignTo(instance.exitCode, value);
+                    else if (currentKey == "downloadTimeouts") AssignTo(instance.downloadTimeouts, value);
+                    break;
+                }
+            case Section::Shared:
+                {
+                    auto& shared = response.shared.value();
+
+                    if (currentKey == "windowTitle") AssignTo(shared.windowTitle, value);
+                    else if (currentKey == "productName") AssignTo(shared.productName, value);
+                    else if (currentKey == "detectionMethod") AssignTo(shared.detectionMethod, value);
+                    else if (currentKey == "detection") shared.detection = std::move(value);
+                    break;
+                }
+            case Section::Releases:
+                response.releases.Add(std::move(value));
+                break;
+            default:
+                // unknown or misplaced, ignored just like the regular deserializer does
+                break;
+            }
+        }
+
+        /**
+         * \brief Routes a scalar either into the collected value or straight into the model.
+         */
+        bool Scalar(json&& value)
+        {
+            if (collecting.empty())
+            {
+                Assign(std::move(value));
+                return true;
+            }
+
+            json& container = *collecting.back();
+
+            if (container.is_object())
+            {
+                container[collectingKey] = std::move(value);
+            }
+            else
+            {
+                container.push_back(std::move(value));
+            }
+
+            return true;
+        }
+
+        /**
+         * \brief Starts a nested container within the collected value.
+         */
+        void BeginCollecting(json&& empty)
+        {
+            if (collecting.empty())
+            {
+                collected = std::move(empty);
+                collecting.push_back(&collected);
+                return;
+            }
+
+            json& container = *collecting.back();
+
+            // the child stays put while it's on the stack, the parent doesn't grow meanwhile
+            if (container.is_object())
+            {
+                collecting.push_back(&(container[collectingKey] = std::move(empty)));
+            }
+            else
+            {
+                container.push_back(std::move(empty));
+                collecting.push_back(&container.back());
+            }
+        }
+
+        void EndCollecting()
+        {
+            collecting.pop_back();
+
+            if (collecting.empty())
+            {
+                Assign(std::move(collected));
+                collected = nullptr;
+            }
+        }
+
+    public:
+        /** Describes the syntax error, if any */
+        std::string error;
+
+        explicit UpdateResponseReader(models::UpdateResponse& response) : response(response)
+        {
+        }
+
+        bool null() override
+        {
+            return Scalar(nullptr);
+        }
+
+        bool boolean(const bool val) override
+        {
+            return Scalar(val);
+        }
+
+        bool number_integer(const number_integer_t val) override
+        {
+            return Scalar(val);
+        }
+
+        bool number_unsigned(const number_unsigned_t val) override
+        {
+            return Scalar(val);
+        }
+
+        bool number_float(const number_float_t val, const string_t& s) override
+        {
+            UNREFERENCED_PARAMETER(s);
+            return Scalar(val);
+        }
+
+        bool string(string_t& val) override
+        {
+            return Scalar(std::move(val));
+        }
+
+        bool binary(binary_t& val) override
+        {
+            return Scalar(json::binary(std::move(val)));
+        }
+
+        bool start_object(const std::size_t elements) override
+        {
+            UNREFERENCED_PARAMETER(elements);
+
+            if (!collecting.empty())
+            {
+                BeginCollecting(json::object());
+                return true;
+            }
+
+            switch (section)
+            {
+            case Section::None:
+                section = Section::Root;
+                return true;
+            case Section::Root:
+                if (currentKey == "instance")
+                {
+                    response.instance.emplace();
+                    section = Section::Instance;
+                    return true;
+                }
+                if (currentKey == "shared")
+                {
+                    response.shared.emplace();
+                    section = Section::Shared;
+                    return true;
+                }
+                break;
+            default:
+                break;
+            }
+
+            BeginCollecting(json::object());
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (!collecting.empty())
+            {
+                EndCollecting();
+                return true;
+            }
+
+            switch (section)
+            {
+            case Section::Instance:
+            case Section::Shared:
+                section = Section::Root;
+                break;
+            case Section::Root:
+                section = Section::Done;
+                break;
+            default:
+                break;
+            }
+
+            return true;
+        }
+
+        bool start_array(const std::size_t elements) override
+        {
+            if (!collecting.empty())
+            {
+                BeginCollecting(json::array());
+                return true;
+            }
+
+            if (section == Section::Root && currentKey == "releases")
+            {
+                if (elements != static_cast<std::size_t>(-1))
+                {
+                    response.releases.Reserve(elements);
+                }
+
+                section = Section::Releases;
+                return true;
+            }
+
+            BeginCollecting(json::array());
+            return true;
+        }
+
+        bool end_array() override
+        {
+            if (!collecting.empty())
+            {
+                EndCollecting();
+                return true;
+            }
+
+            if (section == Section::Releases)
+            {
+                response.releases.Sort();
+                section = Section::Root;
+            }
+
+            return true;
+        }
+
+        bool key(string_t& val) override
+        {
+            if (collecting.empty())
+            {
+                currentKey = std::move(val);
+            }
+            else
+            {
+                collectingKey = std::move(val);
+            }
+
+            return true;
+        }
+
+        bool parse_error(const std::size_t position, const std::string& last_token,
+                         const nlohmann::detail::exception& ex) override
+        {
+            UNREFERENCED_PARAMETER(position);
+            UNREFERENCED_PARAMETER(last_token);
+
+            error = ex.what();
+            return false;
+        }
+
+        /**
+         * \brief True if a complete document has been read.
+         */
+        [[nodiscard]] bool IsComplete() const { return section == Section::Done; }
+    };
+
+    /**
+     * \brief Runs the reader over the input and translates the outcome.
+     */
+    bool Deserialize(std::istream& input, const net::FeedEncoding encoding, models::UpdateResponse& response,
+                     std::string& error)
+    {
+        auto format = nlohmann::detail::input_format_t::json;
+
+        switch (encoding)
+        {
+        case net::FeedEncoding::Cbor:
+            format = nlohmann::detail::input_format_t::cbor;
+            break;
+        case net::FeedEncoding::MessagePack:
+            format = nlohmann::detail::input_format_t::msgpack;
+            break;
+        case net::FeedEncoding::Json:
+            break;
+        }
+
+        try
+        {
+            UpdateResponseReader reader(response);
+
+            if (!json::sax_parse(input, &reader, format) || !reader.IsComplete())
+            {
+                error = reader.error.empty() ? "Unexpected document structure" : reader.error;
+                return false;
+            }
+
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            // e.g. wrong value types, or running out of memory while building the index; this runs on
+            // the parser thread, so nothing may escape
+            error = e.what();
+            return false;
+        }
+    }
+
+    /**
+     * \brief State shared between the curl callbacks and the parser thread.
+     */
+    struct FeedTransfer
+    {
+        CURL* handle{nullptr};
+        const net::FeedRequest* request{nullptr};
+        long statusCode{0};
+        std::map<std::string, std::string> headers;
+        std::ofstream bodyFile;
+        ChunkStreamBuffer buffer;
+        std::unique_ptr<BodyDecoder> decoder;
+        std::thread parser;
+        models::UpdateResponse* response{nullptr};
+        net::FeedEncoding encoding{net::FeedEncoding::Json};
+        bool isParsed{false};
+        std::string error;
+        std::string decodeError;
+
+        void StartParser()
+        {
+            // the headers are complete by the time the body arrives
+            const bool isTransferDecoded = !GetHeaderValue(headers, "Content-Encoding").empty();
+
+            // a precompressed file is only described by its name, unless the host declared it as
+            // transfer compression in which case curl already takes care of it
+            if (request->compression != net::FeedCompression::None && !isTransferDecoded)
+            {
+                decoder = CreateDecoder(request->compression);
+                encoding = GetPrecompressedEncoding(request->url, request->compression);
+            }
+            else
+            {
+                encoding = net::FeedReader::GetEncoding(GetHeaderValue(headers, "Content-Type"));
+            }
+
+            parser = std::thread([this, encoding = encoding]
+            {
+                std::istream input(&buffer);
+                isParsed = Deserialize(input, encoding, *response, error);
+
+                // stop the transfer if the body is garbage, don't block it if there's trailing data
+                buffer.Abandon();
+            });
+        }
+
+        /**
+         * \brief Passes decoded body data on to the body file and the parser.
+         * \return False if the parser doesn't accept any more input.
+         */
+        bool Forward(const char* data, const size_t length)
+        {
+            if (bodyFile.is_open())
+            {
+                bodyFile.write(data, static_cast<std::streamsize>(length));
+            }
+
+            return buffer.Push(data, length);
+        }
+    };
+
+    size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+    {
+        auto* transfer = static_cast<FeedTransfer*>(userdata);
+        const auto bytes = size * nitems;
+
+        // each new status line (e.g. after a redirect) starts a new set of headers
+        if (bytes > 5 && std::string_view(buffer, 5) == "HTTP/")
+        {
+            transfer->headers.clear();
+            return bytes;
+        }
+
+        if (std::string name, value; util::ParseHeaderLine(buffer, bytes, name, value))
+        {
+            transfer->headers[name] = value;
+        }
+
+        return bytes;
+    }
+
+    size_t WriteCallback(char* data, size_t size, size_t nmemb, void* userdata)
+    {
+        auto* transfer = static_cast<FeedTransfer*>(userdata);
+        const auto bytes = size * nmemb;
+
+        if (transfer->statusCode == 0)
+        {
+            curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &transfer->statusCode);
+        }
+
+        // error pages are of no interest
+        if (transfer->statusCode != 200)
+        {
+            return bytes;
+        }
+
+        if (!transfer->parser.joinable())
+        {
+            transfer->StartParser();
+        }
+
+        if (transfer->decoder == nullptr)
+        {
+            // parser bailed out, no need to receive the rest
+            return transfer->Forward(data, bytes) ? bytes : 0;
+        }
+
+        bool isRefused = false;
+
+        const bool isDecoded = transfer->decoder->Decode(data, bytes, [transfer, &isRefused](const char* chunk,
+                                                             const size_t length)
+        {
+            isRefused = !transfer->Forward(chunk, length);
+            return !isRefused;
+        });
+
+        if (!isDecoded)
+        {
+            // a parser that bailed out reports its own error
+            if (!isRefused)
+            {
+                transfer->decodeError = "Corrupt compressed body";
+            }
+
+            return 0;
+        }
+
+        return bytes;
+    }
+
+    int ProgressCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        const auto* isCancelled = static_cast<const std::atomic<bool>*>(clientp);
+
+        return isCancelled->load() ? 1 : 0;
+    }
+}
+
+net::FeedEncoding net::FeedReader::GetEncoding(std::string_view contentType)
+{
+    contentType = contentType.substr(0, contentType.find(';'));
+
+    while (!contentType.empty() && (contentType.front() == ' ' || contentType.front() == '\t'))
+        contentType.remove_prefix(1);
+
+    while (!contentType.empty() && (contentType.back() == ' ' || contentType.back() == '\t'))
+        contentType.remove_suffix(1);
+
+    const std::string mediaType(contentType);
+
+    if (util::icompare(mediaType, "application/cbor"))
+    {
+        return FeedEncoding::Cbor;
+    }
+
+    if (util::icompare(mediaType, "application/msgpack") ||
+        util::icompare(mediaType, "application/x-msgpack") ||
+        util::icompare(mediaType, "application/vnd.msgpack"))
+    {
+        return FeedEncoding::MessagePack;
+    }
+
+    return FeedEncoding::Json;
+}
+
+std::string net::FeedReader::GetContentType(const FeedEncoding encoding)
+{
+    switch (encoding)
+    {
+    case FeedEncoding::Cbor:
+        return "application/cbor";
+    case FeedEncoding::MessagePack:
+        return "application/msgpack";
+    case FeedEncoding::Json:
+        break;
+    }
+
+    return "application/json";
+}
+
+std::string net::FeedReader::GetPrecompressedUrl(const std::string& url, const FeedCompression compression)
+{
+    const auto suffix = GetCompressionSuffix(compression);
+
+    // only static files have siblings
+    if (suffix.empty() || GetUrlExtension(url).empty())
+    {
+        return {};
+    }
+
+    const auto [path, rest] = SplitUrlPath(url);
+
+    return std::format("{}{}{}", path, suffix, rest);
+}
+
+net::FeedResult net::FeedReader::Fetch(const FeedRequest& request, models::UpdateResponse& response)
+{
+    FeedResult result;
+    FeedTransfer transfer;
+    transfer.response = &response;
+
+    auto& pool = ConnectionPool::Instance();
+    CURL* curl = pool.Acquire();
+
+    if (curl == nullptr)
+    {
+        result.code = CURLE_FAILED_INIT;
+        return result;
+    }
+
+    curl_slist* headerList = nullptr;
+
+    for (const auto& [name, value] : request.headers)
+    {
+        headerList = curl_slist_append(headerList, std::format("{}: {}", name, value).c_str());
+    }
+
+    if (!request.bodyFile.empty())
+    {
+        transfer.bodyFile.open(request.bodyFile, std::ios::binary | std::ios::trunc);
+    }
+
+    transfer.handle = curl;
+    transfer.request = &request;
+
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, request.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    // offers every content encoding curl was built with, decoded on the fly
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, request.timeout);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+
+    if (request.isCancelled != nullptr)
+    {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, request.isCancelled);
+    }
+
+    // not run through the shared multiplexing handle, the write callback blocks while the parser catches up
+    const CURLcode code = curl_easy_perform(curl);
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &transfer.statusCode);
+
+    // the parser sees the end of input now and finishes up
+    transfer.buffer.Close();
+
+    if (transfer.parser.joinable())
+    {
+        transfer.parser.join();
+    }
+
+    transfer.bodyFile.close();
+
+    pool.Release(curl);
+    curl_slist_free_all(headerList);
+
+    result.headers = std::move(transfer.headers);
+
+    // a write error caused by the parser or decoder is a content problem, not a transport one
+    if (code != CURLE_OK &&
+        !(code == CURLE_WRITE_ERROR && (!transfer.error.empty() || !transfer.decodeError.empty())))
+    {
+        result.code = code;
+        return result;
+    }
+
+    result.code = static_cast<int>(transfer.statusCode);
+
+    if (result.code == 200)
+    {
+        if (transfer.decoder != nullptr && transfer.decodeError.empty() && !transfer.decoder->IsComplete())
+        {
+            transfer.decodeError = "Truncated compressed body";
+        }
+
+        result.contentType = GetContentType(transfer.encoding);
+        result.isParsed = transfer.isParsed && transfer.decodeError.empty();
+
+        if (!transfer.error.empty())
+        {
+            result.error = transfer.error;
+        }
+        else if (!transfer.decodeError.empty())
+        {
+            result.error = transfer.decodeError;
+        }
+        // no body at all never even started the parser
+        else if (!transfer.isParsed)
+        {
+            result.error = "Empty response";
+        }
+    }
+
+    return result;
+}
+
+bool net::FeedReader::ReadFile(const std::filesystem::path& bodyFile, const FeedEncoding encoding,
+                               models::UpdateResponse& response, std::string& error)
+{
+    std::ifstream stream(bodyFile, std::ios::binary);
+
+    if (!stream.is_open())
+    {
+        error = std::format("Failed to open {}", bodyFile.string());
+        return false;
+    }
+
+    return Deserialize(stream, encoding, response, error);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <curl/curl.h>
+
+#include "UpdateResponse.hpp"
+
+
+namespace net
+{
+    /**
+     * \brief Encodings the update information can be transferred in.
+     */
+    enum class FeedEncoding
+    {
+        Json,
+        Cbor,
+        MessagePack
+    };
+
+    /**
+     * \brief Compression applied to a stored update information file.
+     */
+    enum class FeedCompression
+    {
+        None,
+        Gzip,
+        Zstd
+    };
+
+    /**
+     * \brief Parameters of an update information request.
+     */
+    struct FeedRequest
+    {
+        /** The update information URL */
+        std::string url;
+        /** The User Agent string to send */
+        std::string userAgent;
+        /** Additional request headers */
+        std::map<std::string, std::string> headers;
+        /** Total transfer timeout in seconds */
+        long timeout{5};
+        /** If set, the decoded response body gets copied to this file as it arrives */
+        std::filesystem::path bodyFile;
+        /** Compression of the requested file itself, for precompressed variants on static hosts */
+        FeedCompression compression{FeedCompression::None};
+        /** Set by the owner to abort the transfer, e.g. when another mirror answered first */
+        const std::atomic<bool>* isCancelled{nullptr};
+    };
+
+    /**
+     * \brief Outcome of an update information request.
+     */
+    struct FeedResult
+    {
+        /** The HTTP status code or a CURLcode on transport errors */
+        int code{-1};
+        /** The response headers of the final response */
+        std::map<std::string, std::string> headers;
+        /** The media type of the decoded body */
+        std::string contentType;
+        /** True if the body was received completely and deserialized successfully */
+        bool isParsed{false};
+        /** Describes why the body couldn't be deserialized */
+        std::string error;
+    };
+
+    /**
+     * \brief Fetches and deserializes the update information in one pass.
+     * \remarks The body is decompressed and parsed on a separate thread while it's still being received
+     *          and goes straight into the models without an intermediate string or DOM copy.
+     */
+    class FeedReader
+    {
+    public:
+        /** Accept header value listing the supported encodings, the most compact ones preferred */
+        static constexpr auto AcceptedContentTypes =
+            "application/cbor, application/msgpack;q=0.9, application/json;q=0.5";
+
+        /**
+         * \brief Maps a Content-Type header value to the encoding of the body.
+         * \param contentType The media type, parameters are ignored.
+         * \return The encoding, JSON for anything unknown or missing.
+         */
+        static FeedEncoding GetEncoding(std::string_view contentType);
+
+        /**
+         * \brief Maps an encoding to its media type.
+         */
+        static std::string GetContentType(FeedEncoding encoding);
+
+        /**
+         * \brief Builds the URL of a precompressed sibling of the update information file.
+         * \param url The update information URL.
+         * \param compression The compression of the sibling.
+         * \return The sibling URL (e.g. "updates.json.zst") or empty if the URL doesn't address a file.
+         */
+        static std::string GetPrecompressedUrl(const std::string& url, FeedCompression compression);
+
+        /**
+         * \brief Requests the update information.
+         * \param request The request parameters.
+         * \param response Receives the deserialized body if the server answered with 200.
+         * \return The outcome.
+         */
+        static FeedResult Fetch(const FeedRequest& request, models::UpdateResponse& response);
+
+        /**
+         * \brief Deserializes update information previously stored on disk.
+         * \param bodyFile Full pathname of the stored body.
+         * \param encoding The encoding the body was received in.
+         * \param response Receives the deserialized content.
+         * \param error Describes the failure, if any.
+         * \return True on success, false otherwise.
+         */
+        static bool ReadFile(const std::filesystem::path& bodyFile, FeedEncoding encoding,
+                             models::UpdateResponse& response, std::string& error);
+    };
+}
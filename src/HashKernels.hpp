@@ -0,0 +1,486 @@
+#pragma once
+
+// shared with the self-updater, which doesn't use the precompiled header
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <intrin.h>
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#else
+#include <immintrin.h>
+#endif
+
+
+namespace hashing
+{
+    /**
+     * \brief Implementations of the SHA compression functions.
+     */
+    enum class Kernel
+    {
+        /** The scalar hash-library code, runs everywhere */
+        Portable,
+        /** Intel SHA extensions, with SSSE3 and SSE4.1 for the shuffles */
+        ShaNi,
+        /** ARMv8 cryptography extensions */
+        ArmCrypto
+    };
+
+    namespace kernels
+    {
+        inline constexpr std::array<uint32_t, 64> Sha256K = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        /**
+         * \brief Checks which accelerated kernel the CPU supports.
+         */
+        inline Kernel Detect()
+        {
+#if defined(_M_ARM64)
+            return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE)
+                       ? Kernel::ArmCrypto
+                       : Kernel::Portable;
+#elif defined(_M_X64) || defined(_M_IX86)
+            int registers[4]{};
+
+            __cpuid(registers, 0);
+
+            if (registers[0] < 7)
+            {
+                return Kernel::Portable;
+            }
+
+            __cpuid(registers, 1);
+            const bool hasSsse3 = (registers[2] & 1 << 9) != 0;
+            const bool hasSse41 = (registers[2] & 1 << 19) != 0;
+
+            __cpuidex(registers, 7, 0);
+            const bool hasSha = (registers[1] & 1 << 29) != 0;
+
+            return hasSsse3 && hasSse41 && hasSha ? Kernel::ShaNi : Kernel::Portable;
+#else
+            return Kernel::Portable;
+#endif
+        }
+
+#if defined(_M_ARM64)
+        inline uint32x4_t LoadBigEndian(const uint8_t* data)
+        {
+            return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+        }
+
+        /**
+         * \brief 4 rounds of SHA-1, the message schedule stays 4 groups ahead.
+         */
+        template <int Group>
+        __forceinline void Sha1Group(uint32x4_t& abcd, uint32_t& e, uint32x4_t (&w)[4])
+        {
+            constexpr uint32_t K[] = {0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6};
+            auto& current = w[Group % 4];
+
+            if constexpr (Group >= 4)
+            {
+                current = vsha1su1q_u32(vsha1su0q_u32(current, w[(Group + 1) % 4], w[(Group + 2) % 4]),
+                                        w[(Group + 3) % 4]);
+            }
+
+            const uint32x4_t wk = vaddq_u32(current, vdupq_n_u32(K[Group / 5]));
+            const uint32_t eNext = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+            if constexpr (Group / 5 == 0)
+                abcd = vsha1cq_u32(abcd, e, wk);
+            else if constexpr (Group / 5 == 2)
+                abcd = vsha1mq_u32(abcd, e, wk);
+            else
+                abcd = vsha1pq_u32(abcd, e, wk);
+
+            e = eNext;
+        }
+
+        template <int... Groups>
+        __forceinline void Sha1Rounds(uint32x4_t& abcd, uint32_t& e, uint32x4_t (&w)[4], std::integer_sequence<int, Groups...>)
+        {
+            (Sha1Group<Groups>(abcd, e, w), ...);
+        }
+
+        /**
+         * \brief Runs the SHA-1 compression function over whole blocks.
+         */
+        inline void Sha1Blocks(uint32_t state[5], const uint8_t* data, size_t blocks)
+        {
+            uint32x4_t abcd = vld1q_u32(state);
+            uint32_t e = state[4];
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                const uint32x4_t abcdSaved = abcd;
+                const uint32_t eSaved = e;
+
+                uint32x4_t w[4] = {
+                    LoadBigEndian(data), LoadBigEndian(data + 16), LoadBigEndian(data + 32), LoadBigEndian(data + 48)
+                };
+
+                Sha1Rounds(abcd, e, w, std::make_integer_sequence<int, 20>{});
+
+                abcd = vaddq_u32(abcd, abcdSaved);
+                e += eSaved;
+            }
+
+            vst1q_u32(state, abcd);
+            state[4] = e;
+        }
+
+        /**
+         * \brief 4 rounds of SHA-256, the message schedule stays 4 groups ahead.
+         */
+        template <int Group>
+        __forceinline void Sha256Group(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t (&w)[4])
+        {
+            auto& current = w[Group % 4];
+
+            if constexpr (Group >= 4)
+            {
+                current = vsha256su1q_u32(vsha256su0q_u32(current, w[(Group + 1) % 4]),
+                                          w[(Group + 2) % 4], w[(Group + 3) % 4]);
+            }
+
+            const uint32x4_t wk = vaddq_u32(current, vld1q_u32(&Sha256K[Group * 4]));
+            const uint32x4_t previous = abcd;
+
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, previous, wk);
+        }
+
+        template <int... Groups>
+        __forceinline void Sha256Rounds(uint32x4_t& abcd, uint32x4_t& efgh, uint32x4_t (&w)[4],
+                          std::integer_sequence<int, Groups...>)
+        {
+            (Sha256Group<Groups>(abcd, efgh, w), ...);
+        }
+
+        /**
+         * \brief Runs the SHA-256 compression function over whole blocks.
+         */
+        inline void Sha256Blocks(uint32_t state[8], const uint8_t* data, size_t blocks)
+        {
+            uint32x4_t abcd = vld1q_u32(state);
+            uint32x4_t efgh = vld1q_u32(state + 4);
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                const uint32x4_t abcdSaved = abcd;
+                const uint32x4_t efghSaved = efgh;
+
+                uint32x4_t w[4] = {
+                    LoadBigEndian(data), LoadBigEndian(data + 16), LoadBigEndian(data + 32), LoadBigEndian(data + 48)
+                };
+
+                Sha256Rounds(abcd, efgh, w, std::make_integer_sequence<int, 16>{});
+
+                abcd = vaddq_u32(abcd, abcdSaved);
+                efgh = vaddq_u32(efgh, efghSaved);
+            }
+
+            vst1q_u32(state, abcd);
+            vst1q_u32(state + 4, efgh);
+        }
+#else
+        inline __m128i LoadBigEndian(const uint8_t* data, const __m128i byteSwap)
+        {
+            return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), byteSwap);
+        }
+
+        /**
+         * \brief 4 rounds of SHA-1, the message schedule stays 4 groups ahead.
+         */
+        template <int Group>
+        __forceinline void Sha1Group(__m128i& abcd, __m128i& e, __m128i (&w)[4])
+        {
+            auto& current = w[Group % 4];
+
+            if constexpr (Group >= 4)
+            {
+                current = _mm_sha1msg2_epu32(
+                    _mm_xor_si128(_mm_sha1msg1_epu32(current, w[(Group + 1) % 4]), w[(Group + 2) % 4]),
+                    w[(Group + 3) % 4]);
+            }
+
+            // E of the first group is known, later ones derive from A of the group before
+            __m128i ew;
+
+            if constexpr (Group == 0)
+                ew = _mm_add_epi32(e, current);
+            else
+                ew = _mm_sha1nexte_epu32(e, current);
+
+            e = abcd;
+            abcd = _mm_sha1rnds4_epu32(abcd, ew, Group / 5);
+        }
+
+        template <int... Groups>
+        __forceinline void Sha1Rounds(__m128i& abcd, __m128i& e, __m128i (&w)[4], std::integer_sequence<int, Groups...>)
+        {
+            (Sha1Group<Groups>(abcd, e, w), ...);
+        }
+
+        /**
+         * \brief Runs the SHA-1 compression function over whole blocks.
+         */
+        inline void Sha1Blocks(uint32_t state[5], const uint8_t* data, size_t blocks)
+        {
+            const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+            __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+            __m128i e = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                const __m128i abcdSaved = abcd;
+                const __m128i eSaved = e;
+
+                __m128i w[4] = {
+                    LoadBigEndian(data, byteSwap), LoadBigEndian(data + 16, byteSwap),
+                    LoadBigEndian(data + 32, byteSwap), LoadBigEndian(data + 48, byteSwap)
+                };
+
+                Sha1Rounds(abcd, e, w, std::make_integer_sequence<int, 20>{});
+
+                e = _mm_sha1nexte_epu32(e, eSaved);
+                abcd = _mm_add_epi32(abcd, abcdSaved);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+            state[4] = static_cast<uint32_t>(_mm_extract_epi32(e, 3));
+        }
+
+        /**
+         * \brief 4 rounds of SHA-256, the message schedule stays 4 groups ahead.
+         */
+        template <int Group>
+        __forceinline void Sha256Group(__m128i& abef, __m128i& cdgh, __m128i (&w)[4])
+        {
+            auto& current = w[Group % 4];
+
+            if constexpr (Group >= 4)
+            {
+                const __m128i partial = _mm_add_epi32(
+                    _mm_sha256msg1_epu32(current, w[(Group + 1) % 4]),
+                    _mm_alignr_epi8(w[(Group + 3) % 4], w[(Group + 2) % 4], 4));
+
+                current = _mm_sha256msg2_epu32(partial, w[(Group + 3) % 4]);
+            }
+
+            __m128i wk = _mm_add_epi32(current, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&Sha256K[Group * 4])));
+
+            // each instruction does 2 rounds with the lower 2 words
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+            wk = _mm_shuffle_epi32(wk, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, wk);
+        }
+
+        template <int... Groups>
+        __forceinline void Sha256Rounds(__m128i& abef, __m128i& cdgh, __m128i (&w)[4], std::integer_sequence<int, Groups...>)
+        {
+            (Sha256Group<Groups>(abef, cdgh, w), ...);
+        }
+
+        /**
+         * \brief Runs the SHA-256 compression function over whole blocks.
+         */
+        inline void Sha256Blocks(uint32_t state[8], const uint8_t* data, size_t blocks)
+        {
+            const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+            // the instructions want the state as ABEF and CDGH
+            const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+            __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+            __m128i abef = _mm_alignr_epi8(dcba, cdgh, 8);
+            cdgh = _mm_blend_epi16(cdgh, dcba, 0xF0);
+
+            for (; blocks > 0; blocks--, data += 64)
+            {
+                const __m128i abefSaved = abef;
+                const __m128i cdghSaved = cdgh;
+
+                __m128i w[4] = {
+                    LoadBigEndian(data, byteSwap), LoadBigEndian(data + 16, byteSwap),
+                    LoadBigEndian(data + 32, byteSwap), LoadBigEndian(data + 48, byteSwap)
+                };
+
+                Sha256Rounds(abef, cdgh, w, std::make_integer_sequence<int, 16>{});
+
+                abef = _mm_add_epi32(abef, abefSaved);
+                cdgh = _mm_add_epi32(cdgh, cdghSaved);
+            }
+
+            const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+            const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+        }
+#endif
+
+        struct Sha1
+        {
+            static constexpr std::array<uint32_t, 5> InitialState = {
+                0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+            };
+
+            static void Compress(uint32_t* state, const uint8_t* data, const size_t blocks)
+            {
+                Sha1Blocks(state, data, blocks);
+            }
+        };
+
+        struct Sha256
+        {
+            static constexpr std::array<uint32_t, 8> InitialState = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+            };
+
+            static void Compress(uint32_t* state, const uint8_t* data, const size_t blocks)
+            {
+                Sha256Blocks(state, data, blocks);
+            }
+        };
+    }
+
+    /**
+     * \brief The accelerated kernel supported by this CPU, detected once.
+     * \return The kernel or Portable if the CPU has none.
+     */
+    inline Kernel GetAcceleratedKernel()
+    {
+        static const Kernel kernel = kernels::Detect();
+        return kernel;
+    }
+
+    /**
+     * \brief SHA hashing on the accelerated kernel, a drop-in for the hash-library classes.
+     * \remarks Only to be used if GetAcceleratedKernel found one. Header-only so the self-updater
+     *          can use it as well.
+     */
+    template <typename Algorithm>
+    class AcceleratedSha
+    {
+        std::array<uint32_t, Algorithm::InitialState.size()> state;
+        std::array<uint8_t, 64> buffer{};
+        size_t buffered{0};
+        uint64_t totalBytes{0};
+
+    public:
+        enum { BlockSize = 64, HashBytes = Algorithm::InitialState.size() * 4 };
+
+        AcceleratedSha() { reset(); }
+
+        void reset()
+        {
+            state = Algorithm::InitialState;
+            buffered = 0;
+            totalBytes = 0;
+        }
+
+        void add(const void* data, size_t numBytes)
+        {
+            auto current = static_cast<const uint8_t*>(data);
+            totalBytes += numBytes;
+
+            if (buffered > 0)
+            {
+                const size_t taken = std::min(numBytes, BlockSize - buffered);
+                std::memcpy(buffer.data() + buffered, current, taken);
+                buffered += taken;
+                current += taken;
+                numBytes -= taken;
+
+                if (buffered < BlockSize)
+                {
+                    return;
+                }
+
+                Algorithm::Compress(state.data(), buffer.data(), 1);
+                buffered = 0;
+            }
+
+            // whole blocks straight from the caller's memory
+            if (const size_t blocks = numBytes / BlockSize; blocks > 0)
+            {
+                Algorithm::Compress(state.data(), current, blocks);
+                current += blocks * BlockSize;
+                numBytes -= blocks * BlockSize;
+            }
+
+            std::memcpy(buffer.data(), current, numBytes);
+            buffered = numBytes;
+        }
+
+        /**
+         * \brief Completes the calculation and writes the binary digest, resets the state afterwards.
+         */
+        void getHash(unsigned char digest[HashBytes])
+        {
+            const uint64_t totalBits = totalBytes * 8;
+            std::array<uint8_t, BlockSize * 2> padding{};
+            // the length has to fit behind the terminating bit, otherwise it spills into another block
+            const size_t paddingSize = (buffered < BlockSize - 8 ? BlockSize : BlockSize * 2) - buffered;
+
+            padding[0] = 0x80;
+
+            for (int index = 0; index < 8; index++)
+            {
+                padding[paddingSize - 1 - index] = static_cast<uint8_t>(totalBits >> index * 8);
+            }
+
+            add(padding.data(), paddingSize);
+
+            for (size_t index = 0; index < state.size(); index++)
+            {
+                digest[index * 4] = static_cast<uint8_t>(state[index] >> 24);
+                digest[index * 4 + 1] = static_cast<uint8_t>(state[index] >> 16);
+                digest[index * 4 + 2] = static_cast<uint8_t>(state[index] >> 8);
+                digest[index * 4 + 3] = static_cast<uint8_t>(state[index]);
+            }
+
+            reset();
+        }
+
+        /**
+         * \brief Completes the calculation, resets the state afterwards.
+         * \return The lowercase hex digest.
+         */
+        std::string getHash()
+        {
+            constexpr std::string_view digits = "0123456789abcdef";
+            unsigned char digest[HashBytes];
+            std::string hex;
+
+            getHash(digest);
+
+            for (const unsigned char value : digest)
+            {
+                hex += digits[value >> 4];
+                hex += digits[value & 0x0F];
+            }
+
+            return hex;
+        }
+    };
+
+    using AcceleratedSha1 = AcceleratedSha<kernels::Sha1>;
+    using AcceleratedSha256 = AcceleratedSha<kernels::Sha256>;
+}
@@ -0,0 +1,822 @@
+#include "pch.h"
+#include "Common.h"
+#include "Hashing.hpp"
+
+
+namespace
+{
+    /** Upper bound of copied data waiting for the hashing worker */
+    constexpr size_t MaxQueuedBytes = 32 * 1024 * 1024;
+
+    /** Chunk size used when reading data back from the file */
+    constexpr DWORD ReadBackChunkSize = 1024 * 1024;
+
+    /** Size of each mapped view of a hashed file, a multiple of the allocation granularity */
+    constexpr int64_t MappedViewSize = 64 * 1024 * 1024;
+
+    /** Updates at least this large are split across threads by BLAKE3, unless they come from a mapped view */
+    constexpr size_t ParallelHashThreshold = 1024 * 1024;
+
+    /** Data hashed per benchmark run */
+    constexpr size_t BenchmarkBufferSize = 64 * 1024 * 1024;
+
+    /** Passes over the benchmark buffer per algorithm and kernel */
+    constexpr int BenchmarkRounds = 4;
+
+    /**
+     * \brief Adapts the hash-library implementations and the accelerated ones sharing their interface.
+     */
+    template <typename T>
+    class HashLibraryHasher final : public hashing::Hasher
+    {
+        T algorithm;
+
+    public:
+        void Update(const void* data, const size_t length) override
+        {
+            algorithm.add(data, length);
+        }
+
+        std::vector<uint8_t> Finalize() override
+        {
+            std::vector<uint8_t> digest(T::HashBytes);
+            algorithm.getHash(digest.data());
+            return digest;
+        }
+    };
+
+    /**
+     * \brief BLAKE3, hashing the subtrees of large copied or read buffers on all cores.
+     */
+    class Blake3Hasher final : public hashing::Hasher
+    {
+        blake3_hasher state{};
+
+    public:
+        Blake3Hasher()
+        {
+            blake3_hasher_init(&state);
+        }
+
+        void Update(const void* data, const size_t length) override
+        {
+            // spreading the tree over threads only pays off once there are plenty of chunks
+            if (length >= ParallelHashThreshold)
+            {
+                blake3_hasher_update_tbb(&state, data, length);
+            }
+            else
+            {
+                blake3_hasher_update(&state, data, length);
+            }
+        }
+
+        void UpdateMapped(const void* data, const size_t length) override
+        {
+            // an in-page error on a TBB worker would escape the handler around the view and end the process
+            blake3_hasher_update(&state, data, length);
+        }
+
+        std::vector<uint8_t> Finalize() override
+        {
+            std::vector<uint8_t> digest(BLAKE3_OUT_LEN);
+            blake3_hasher_finalize(&state, digest.data(), digest.size());
+            return digest;
+        }
+    };
+
+    /**
+     * \brief XXH3 with 128 bit output, the digest in canonical (big endian) byte order.
+     */
+    class Xxh128Hasher final : public hashing::Hasher
+    {
+        XXH3_state_t* state{XXH3_createState()};
+
+    public:
+        Xxh128Hasher()
+        {
+            XXH3_128bits_reset(state);
+        }
+
+        Xxh128Hasher(const Xxh128Hasher&) = delete;
+        Xxh128Hasher& operator=(const Xxh128Hasher&) = delete;
+
+        ~Xxh128Hasher() override
+        {
+            XXH3_freeState(state);
+        }
+
+        void Update(const void* data, const size_t length) override
+        {
+            XXH3_128bits_update(state, data, length);
+        }
+
+        std::vector<uint8_t> Finalize() override
+        {
+            XXH128_canonical_t canonical{};
+            XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(state));
+            return {std::begin(canonical.digest), std::end(canonical.digest)};
+        }
+    };
+
+    /**
+     * \brief Feeds a mapped view to the hasher.
+     * \return False if paging in the data failed, e.g. the file lives on a network share that went away.
+     * \remarks Kept free of objects with destructors, structured exception handling doesn't mix with them.
+     */
+    bool HashView(hashing::Hasher* hasher, const void* view, const size_t length)
+    {
+        __try
+        {
+            hasher->UpdateMapped(view, length);
+            return true;
+        }
+        __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+        {
+            return false;
+        }
+    }
+}
+
+std::unique_ptr<hashing::Hasher> hashing::CreateHasher(const models::ChecksumAlgorithm algorithm)
+{
+    return CreateHasher(algorithm, GetAcceleratedKernel());
+}
+
+std::unique_ptr<hashing::Hasher> hashing::CreateHasher(const models::ChecksumAlgorithm algorithm, const Kernel kernel)
+{
+    const bool isAccelerated = kernel != Kernel::Portable;
+
+    switch (algorithm)
+    {
+    case models::ChecksumAlgorithm::MD5:
+        return std::make_unique<HashLibraryHasher<MD5>>();
+    case models::ChecksumAlgorithm::SHA1:
+        if (isAccelerated)
+        {
+            return std::make_unique<HashLibraryHasher<AcceleratedSha1>>();
+        }
+        return std::make_unique<HashLibraryHasher<SHA1>>();
+    case models::ChecksumAlgorithm::SHA256:
+        if (isAccelerated)
+        {
+            return std::make_unique<HashLibraryHasher<AcceleratedSha256>>();
+        }
+        return std::make_unique<HashLibraryHasher<SHA256>>();
+    case models::ChecksumAlgorithm::BLAKE3:
+        return std::make_unique<Blake3Hasher>();
+    case models::ChecksumAlgorithm::XXH128:
+        return std::make_unique<Xxh128Hasher>();
+    case models::ChecksumAlgorithm::Invalid:
+        break;
+    }
+
+    return nullptr;
+}
+
+void hashing::RunBenchmark()
+{
+    std::vector<uint8_t> buffer(BenchmarkBufferSize);
+    std::mt19937 generator(42);
+
+    std::ranges::generate(buffer, [&generator]() { return static_cast<uint8_t>(generator()); });
+
+    std::vector kernels{Kernel::Portable};
+
+    if (GetAcceleratedKernel() != Kernel::Portable)
+    {
+        kernels.push_back(GetAcceleratedKernel());
+    }
+
+    spdlog::info("Hashing {} MiB {} times per algorithm, accelerated kernel: {}",
+                 BenchmarkBufferSize / (1024 * 1024), BenchmarkRounds,
+                 magic_enum::enum_name(GetAcceleratedKernel()));
+
+    for (const auto algorithm : {
+             models::ChecksumAlgorithm::MD5, models::ChecksumAlgorithm::SHA1, models::ChecksumAlgorithm::SHA256,
+             models::ChecksumAlgorithm::BLAKE3, models::ChecksumAlgorithm::XXH128
+         })
+    {
+        const bool hasKernels = algorithm == models::ChecksumAlgorithm::SHA1 ||
+            algorithm == models::ChecksumAlgorithm::SHA256;
+
+        std::vector<uint8_t> reference;
+
+        for (const auto kernel : kernels)
+        {
+            // the others bring their own SIMD dispatch, it would just measure the same code again
+            if (!hasKernels && kernel != Kernel::Portable)
+            {
+                continue;
+            }
+
+            const auto hasher = CreateHasher(algorithm, kernel);
+            const auto started = std::chrono::steady_clock::now();
+
+            for (int round = 0; round < BenchmarkRounds; round++)
+            {
+                hasher->Update(buffer.data(), buffer.size());
+            }
+
+            const auto digest = hasher->Finalize();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+            const double throughput = static_cast<double>(BenchmarkBufferSize) * BenchmarkRounds /
+                elapsed.count() / 1e9;
+
+            spdlog::info("{:<8} {:<10} {:>7.2f} GB/s", magic_enum::enum_name(algorithm),
+                         magic_enum::enum_name(kernel), throughput);
+
+            if (reference.empty())
+            {
+                reference = digest;
+            }
+            else if (digest != reference)
+            {
+                spdlog::error("{} digest of kernel {} doesn't match the portable one",
+                              magic_enum::enum_name(algorithm), magic_enum::enum_name(kernel));
+            }
+        }
+    }
+}
+
+bool hashing::ParseHexDigest(const std::string_view hex, std::vector<uint8_t>& digest)
+{
+    if (hex.empty() || hex.size() % 2 != 0)
+    {
+        return false;
+    }
+
+    auto nibble = [](const char c) -> int
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    digest.resize(hex.size() / 2);
+
+    for (size_t index = 0; index < digest.size(); index++)
+    {
+        const int high = nibble(hex[index * 2]);
+        const int low = nibble(hex[index * 2 + 1]);
+
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+
+        digest[index] = static_cast<uint8_t>(high << 4 | low);
+    }
+
+    return true;
+}
+
+std::string hashing::ToHexDigest(const std::vector<uint8_t>& digest)
+{
+    constexpr char digits[] = "0123456789abcdef";
+    std::string hex(digest.size() * 2, '\0');
+
+    for (size_t index = 0; index < digest.size(); index++)
+    {
+        hex[index * 2] = digits[digest[index] >> 4];
+        hex[index * 2 + 1] = digits[digest[index] & 0x0F];
+    }
+
+    return hex;
+}
+
+std::optional<std::vector<uint8_t>> hashing::HashFile(const models::ChecksumAlgorithm algorithm,
+                                                      const std::filesystem::path& file)
+{
+    const auto hasher = CreateHasher(algorithm);
+
+    if (hasher == nullptr)
+    {
+        spdlog::error("Unsupported checksum algorithm {}", magic_enum::enum_name(algorithm));
+        return std::nullopt;
+    }
+
+    const HANDLE handle = CreateFileW(
+        file.wstring().c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    );
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        spdlog::error("Failed to open {}, error {}", file.string(), GetLastError());
+        return std::nullopt;
+    }
+
+    auto handleGuard = sg::make_scope_guard([handle]() noexcept { CloseHandle(handle); });
+
+    LARGE_INTEGER size{};
+
+    if (!GetFileSizeEx(handle, &size))
+    {
+        spdlog::error("Failed to get size of {}, error {}", file.string(), GetLastError());
+        return std::nullopt;
+    }
+
+    // empty files can't be mapped, their digest is that of no input
+    if (size.QuadPart == 0)
+    {
+        return hasher->Finalize();
+    }
+
+    const HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+        spdlog::error("Failed to map {}, error {}", file.string(), GetLastError());
+        return std::nullopt;
+    }
+
+    auto mappingGuard = sg::make_scope_guard([mapping]() noexcept { CloseHandle(mapping); });
+
+    for (int64_t offset = 0; offset < size.QuadPart; offset += MappedViewSize)
+    {
+        const auto length = static_cast<size_t>(std::min<int64_t>(size.QuadPart - offset, MappedViewSize));
+        const void* view = MapViewOfFile(
+            mapping,
+            FILE_MAP_READ,
+            static_cast<DWORD>(offset >> 32),
+            static_cast<DWORD>(offset & 0xFFFFFFFF),
+            length
+        );
+
+        if (view == nullptr)
+        {
+            spdlog::error("Failed to map view of {} at offset {}, error {}", file.string(), offset, GetLastError());
+            return std::nullopt;
+        }
+
+        // large sequential page-in requests instead of faulting in a few pages at a time
+        WIN32_MEMORY_RANGE_ENTRY range{const_cast<void*>(view), length};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+
+        const bool isHashed = HashView(hasher.get(), view, length);
+
+        UnmapViewOfFile(view);
+
+        if (!isHashed)
+        {
+            spdlog::error("Failed to read {} at offset {}", file.string(), offset);
+            return std::nullopt;
+        }
+    }
+
+    return hasher->Finalize();
+}
+
+std::optional<std::vector<uint8_t>> hashing::HashFile(const models::ChecksumAlgorithm algorithm,
+                                                      const std::filesystem::path& file,
+                                                      models::HashCache& cache)
+{
+    const auto identity = GetFileIdentity(file);
+
+    if (!identity.has_value())
+    {
+        return HashFile(algorithm, file);
+    }
+
+    if (const auto cached = cache.Find(identity.value(), algorithm); cached != nullptr)
+    {
+        spdlog::debug("Using cached {} digest of {}", magic_enum::enum_name(algorithm), file.string());
+        return *cached;
+    }
+
+    auto digest = HashFile(algorithm, file);
+
+    // a file modified while being hashed may have produced a digest of neither state
+    if (digest.has_value() && GetFileIdentity(file) == identity)
+    {
+        cache.Store(identity.value(), algorithm, digest.value());
+    }
+
+    return digest;
+}
+
+std::optional<models::FileIdentity> hashing::GetFileIdentity(const std::filesystem::path& file)
+{
+    // attribute access only, doesn't conflict with writers and never touches the content
+    const HANDLE handle = CreateFileW(
+        file.wstring().c_str(),
+        FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        spdlog::warn("Failed to open {} for attributes, error {}", file.string(), GetLastError());
+        return std::nullopt;
+    }
+
+    auto handleGuard = sg::make_scope_guard([handle]() noexcept { CloseHandle(handle); });
+
+    BY_HANDLE_FILE_INFORMATION info{};
+
+    if (!GetFileInformationByHandle(handle, &info))
+    {
+        spdlog::warn("Failed to get file information of {}, error {}", file.string(), GetLastError());
+        return std::nullopt;
+    }
+
+    models::FileIdentity identity;
+    identity.path = file.string();
+    identity.size = static_cast<uint64_t>(info.nFileSizeHigh) << 32 | info.nFileSizeLow;
+    identity.lastWriteTime = static_cast<int64_t>(
+        static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32 | info.ftLastWriteTime.dwLowDateTime);
+    identity.volumeSerial = info.dwVolumeSerialNumber;
+    identity.fileIndex = static_cast<uint64_t>(info.nFileIndexHigh) << 32 | info.nFileIndexLow;
+
+    return identity;
+}
+
+models::HashCache hashing::LoadHashCache(const std::filesystem::path& cacheFile)
+{
+    std::error_code ec;
+
+    if (cacheFile.empty() || !exists(cacheFile, ec))
+    {
+        return {};
+    }
+
+    try
+    {
+        std::ifstream stream(cacheFile, std::ios::binary);
+        const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+
+        return json::from_cbor(content).get<models::HashCache>();
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("Failed to read hash cache {}, error {}", cacheFile.string(), e.what());
+        return {};
+    }
+}
+
+void hashing::SaveHashCache(const std::filesystem::path& cacheFile, const models::HashCache& cache)
+{
+    if (cacheFile.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        create_directories(cacheFile.parent_path());
+
+        const auto content = json::to_cbor(json(cache));
+
+        util::WriteFileAtomically(cacheFile, content.data(), content.size());
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::warn("Failed to persist hash cache, error {}", e.what());
+    }
+}
+
+std::optional<std::vector<models::FileManifestMismatch>> hashing::VerifyManifest(
+    const models::FileManifestConfig& manifest,
+    models::HashCache* cache,
+    const unsigned int maxThreads
+)
+{
+    if (CreateHasher(manifest.algorithm) == nullptr)
+    {
+        spdlog::error("Unsupported checksum algorithm {}", magic_enum::enum_name(manifest.algorithm));
+        return std::nullopt;
+    }
+
+    const std::filesystem::path root{manifest.root};
+
+    if (!root.is_absolute())
+    {
+        spdlog::error("Manifest root {} is not an absolute path", manifest.root);
+        return std::nullopt;
+    }
+
+    struct Job
+    {
+        size_t index;
+        std::filesystem::path file;
+        models::FileIdentity identity;
+        std::vector<uint8_t> expected;
+        std::optional<std::vector<uint8_t>> digest;
+    };
+
+    std::vector<std::optional<models::FileMismatch>> results(manifest.files.size());
+    std::vector<Job> jobs;
+
+    for (size_t index = 0; index < manifest.files.size(); index++)
+    {
+        const auto& entry = manifest.files[index];
+        const auto relative = std::filesystem::path{entry.path}.lexically_normal();
+
+        if (relative.empty() || relative.has_root_path() || *relative.begin() == "..")
+        {
+            spdlog::error("Manifest path {} is not inside the manifest root", entry.path);
+            return std::nullopt;
+        }
+
+        std::vector<uint8_t> expected;
+
+        if (!ParseHexDigest(util::trim(entry.hash), expected))
+        {
+            spdlog::error("Expected checksum {} of {} is not a valid hex string", entry.hash, entry.path);
+            return std::nullopt;
+        }
+
+        const auto file = root / relative;
+        std::error_code ec;
+
+        if (!exists(file, ec))
+        {
+            results[index] = models::FileMismatch::Missing;
+            continue;
+        }
+
+        const auto identity = GetFileIdentity(file);
+
+        if (!identity.has_value())
+        {
+            results[index] = models::FileMismatch::Unreadable;
+            continue;
+        }
+
+        if (identity.value().size != entry.size)
+        {
+            results[index] = models::FileMismatch::Size;
+            continue;
+        }
+
+        if (cache != nullptr)
+        {
+            if (const auto cached = cache->Find(identity.value(), manifest.algorithm); cached != nullptr)
+            {
+                if (*cached != expected)
+                {
+                    results[index] = models::FileMismatch::Checksum;
+                }
+
+                continue;
+            }
+        }
+
+        jobs.push_back({index, file, identity.value(), std::move(expected), std::nullopt});
+    }
+
+    std::ranges::sort(jobs, {}, [](const Job& job) { return job.identity.size; });
+
+    if (!jobs.empty())
+    {
+        const size_t threadCount = std::clamp<size_t>(
+            std::min(maxThreads, std::max(std::thread::hardware_concurrency(), 1u)), 1, jobs.size());
+        std::atomic<size_t> next{0};
+
+        spdlog::debug("Hashing {} of {} manifest files on {} threads", jobs.size(), manifest.files.size(), threadCount);
+
+        std::vector<std::jthread> workers;
+        workers.reserve(threadCount);
+
+        for (size_t worker = 0; worker < threadCount; worker++)
+        {
+            workers.emplace_back([&jobs, &next, algorithm = manifest.algorithm]()
+            {
+                for (size_t job = next++; job < jobs.size(); job = next++)
+                {
+                    jobs[job].digest = HashFile(algorithm, jobs[job].file);
+                }
+            });
+        }
+    }
+
+    for (auto& job : jobs)
+    {
+        if (!job.digest.has_value())
+        {
+            results[job.index] = models::FileMismatch::Unreadable;
+            continue;
+        }
+
+        if (job.digest.value() != job.expected)
+        {
+            results[job.index] = models::FileMismatch::Checksum;
+        }
+
+        if (cache != nullptr && GetFileIdentity(job.file) == job.identity)
+        {
+            cache->Store(job.identity, manifest.algorithm, std::move(job.digest.value()));
+        }
+    }
+
+    std::vector<models::FileManifestMismatch> mismatches;
+
+    for (size_t index = 0; index < results.size(); index++)
+    {
+        if (results[index].has_value())
+        {
+            mismatches.push_back({manifest.files[index].path, results[index].value()});
+        }
+    }
+
+    return mismatches;
+}
+
+hashing::HashPipeline::HashPipeline(const models::ChecksumAlgorithm algorithm, std::filesystem::path file)
+    : hasher(CreateHasher(algorithm)), file(std::move(file))
+{
+    if (hasher != nullptr)
+    {
+        worker = std::thread(&HashPipeline::Run, this);
+    }
+}
+
+hashing::HashPipeline::~HashPipeline()
+{
+    {
+        std::lock_guard guard(lock);
+        isClosed = true;
+    }
+
+    available.notify_one();
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void hashing::HashPipeline::Push(const char* data, const size_t length, const int64_t offset)
+{
+    if (hasher == nullptr || length == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard guard(lock);
+
+        // hashing fell behind, let the worker fetch it from the file cache instead of hoarding memory
+        if (queuedBytes + length > MaxQueuedBytes)
+        {
+            if (!queue.empty() && queue.back().data.empty() &&
+                queue.back().offset + queue.back().length == offset)
+            {
+                queue.back().length += static_cast<int64_t>(length);
+            }
+            else
+            {
+                queue.push_back({offset, static_cast<int64_t>(length), {}});
+            }
+        }
+        else
+        {
+            queue.push_back({offset, static_cast<int64_t>(length), std::vector(data, data + length)});
+            queuedBytes += length;
+        }
+    }
+
+    available.notify_one();
+}
+
+void hashing::HashPipeline::PushFileRange(const int64_t offset, const int64_t length)
+{
+    if (hasher == nullptr || length <= 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard guard(lock);
+        queue.push_back({offset, length, {}});
+    }
+
+    available.notify_one();
+}
+
+std::optional<std::vector<uint8_t>> hashing::HashPipeline::Finish()
+{
+    if (hasher == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    {
+        std::lock_guard guard(lock);
+        isClosed = true;
+    }
+
+    available.notify_one();
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+
+    if (hasFailed)
+    {
+        return std::nullopt;
+    }
+
+    return hasher->Finalize();
+}
+
+bool hashing::HashPipeline::ReadBack(HANDLE handle, int64_t offset, int64_t length, std::vector<char>& buffer)
+{
+    buffer.resize(ReadBackChunkSize);
+
+    while (length > 0)
+    {
+        OVERLAPPED position{};
+        position.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        const auto toRead = static_cast<DWORD>(std::min<int64_t>(length, ReadBackChunkSize));
+        DWORD read = 0;
+
+        if (!ReadFile(handle, buffer.data(), toRead, &read, &position) || read == 0)
+        {
+            spdlog::error("Failed to read back {} at offset {}, error {}", file.string(), offset, GetLastError());
+            return false;
+        }
+
+        hasher->Update(buffer.data(), read);
+
+        offset += read;
+        length -= read;
+    }
+
+    return true;
+}
+
+void hashing::HashPipeline::Run()
+{
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    std::vector<char> buffer;
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock guard(lock);
+            available.wait(guard, [this] { return !queue.empty() || isClosed; });
+
+            // closed and drained
+            if (queue.empty())
+            {
+                break;
+            }
+
+            job = std::move(queue.front());
+            queue.pop_front();
+            queuedBytes -= job.data.size();
+        }
+
+        // keep draining so the writer never stalls, the result is void anyway
+        if (hasFailed)
+        {
+            continue;
+        }
+
+        if (!job.data.empty())
+        {
+            hasher->Update(job.data.data(), job.data.size());
+            continue;
+        }
+
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            handle = CreateFileA(
+                file.string().c_str(),
+                GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_FLAG_SEQUENTIAL_SCAN,
+                nullptr
+            );
+        }
+
+        if (handle == INVALID_HANDLE_VALUE || !ReadBack(handle, job.offset, job.length, buffer))
+        {
+            hasFailed = true;
+        }
+    }
+
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(handle);
+    }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "UpdateResponse.hpp"
+#include "HashCache.hpp"
+#include "HashKernels.hpp"
+
+
+namespace hashing
+{
+    /**
+     * \brief Incremental message digest calculation.
+     */
+    class Hasher
+    {
+    public:
+        virtual ~Hasher() = default;
+
+        /**
+         * \brief Feeds the next chunk of the message.
+         */
+        virtual void Update(const void* data, size_t length) = 0;
+
+        /**
+         * \brief Feeds the next chunk of the message from a mapped view.
+         * \remarks Reads the view on the calling thread only, so paging errors reach its exception handler.
+         */
+        virtual void UpdateMapped(const void* data, const size_t length)
+        {
+            Update(data, length);
+        }
+
+        /**
+         * \brief Completes the calculation.
+         * \return The binary digest.
+         */
+        virtual std::vector<uint8_t> Finalize() = 0;
+    };
+
+    /**
+     * \brief Creates a hasher for the given algorithm, on the fastest kernel the CPU supports.
+     * \return The hasher or nullptr if the algorithm is not supported.
+     */
+    std::unique_ptr<Hasher> CreateHasher(models::ChecksumAlgorithm algorithm);
+
+    /**
+     * \brief Creates a hasher for the given algorithm on a specific kernel.
+     * \param algorithm The algorithm to use.
+     * \param kernel Portable or the kernel returned by GetAcceleratedKernel, only SHA-1 and SHA-256
+     *               have implementations to choose from.
+     * \return The hasher or nullptr if the algorithm is not supported.
+     */
+    std::unique_ptr<Hasher> CreateHasher(models::ChecksumAlgorithm algorithm, Kernel kernel);
+
+    /**
+     * \brief Measures the throughput of each algorithm on each available kernel and logs it.
+     */
+    void RunBenchmark();
+
+    /**
+     * \brief Converts a hex string (case-insensitive) into binary digest.
+     * \return True on success, false if the string isn't valid hex.
+     */
+    bool ParseHexDigest(std::string_view hex, std::vector<uint8_t>& digest);
+
+    /**
+     * \brief Converts a binary digest into a lowercase hex string.
+     */
+    std::string ToHexDigest(const std::vector<uint8_t>& digest);
+
+    /**
+     * \brief Hashes an existing file through a memory-mapped view.
+     * \remarks The file is mapped in large windows with read-ahead requested for each of them,
+     *          so hashing a big binary costs a handful of page-in requests instead of a read call
+     *          per small chunk.
+     * \param algorithm The algorithm to use.
+     * \param file Full pathname of the file.
+     * \return The binary digest or empty on error.
+     */
+    std::optional<std::vector<uint8_t>> HashFile(models::ChecksumAlgorithm algorithm,
+                                                 const std::filesystem::path& file);
+
+    /**
+     * \brief Hashes an existing file unless its digest is known from an earlier run.
+     * \remarks A cached digest is only trusted while size, last write time, volume and file index
+     *          are unchanged. These are queried through a handle without read access, so an unchanged
+     *          file is never paged in.
+     * \param algorithm The algorithm to use.
+     * \param file Full pathname of the file.
+     * \param cache Digests of earlier runs, updated with the result.
+     * \return The binary digest or empty on error.
+     */
+    std::optional<std::vector<uint8_t>> HashFile(models::ChecksumAlgorithm algorithm,
+                                                 const std::filesystem::path& file,
+                                                 models::HashCache& cache);
+
+    /**
+     * \brief Gets what identifies the current state of a file without opening it for reading.
+     * \return The identity or empty on error.
+     */
+    std::optional<models::FileIdentity> GetFileIdentity(const std::filesystem::path& file);
+
+    /**
+     * \brief Reads the digests persisted by an earlier run.
+     * \return The cache, empty if the file doesn't exist or is damaged.
+     */
+    models::HashCache LoadHashCache(const std::filesystem::path& cacheFile);
+
+    /**
+     * \brief Persists the digests for the next run.
+     */
+    void SaveHashCache(const std::filesystem::path& cacheFile, const models::HashCache& cache);
+
+    /**
+     * \brief Compares the files of a product directory against a manifest.
+     * \remarks Cheapest checks first: missing files and size mismatches are reported without hashing,
+     *          digests of unchanged files are taken from the cache. Only the remaining files get hashed,
+     *          smallest first, on a bounded number of threads.
+     * \param manifest The expected files.
+     * \param cache Digests of earlier runs, updated with the results, nullptr to hash every file.
+     * \param maxThreads Number of files hashed at once, further limited by the number of CPU cores.
+     * \return The differing files in manifest order or empty if the manifest is invalid.
+     */
+    std::optional<std::vector<models::FileManifestMismatch>> VerifyManifest(const models::FileManifestConfig& manifest,
+                                                                           models::HashCache* cache,
+                                                                           unsigned int maxThreads);
+
+    /**
+     * \brief Hashes a file being written on a worker thread, fed strictly in order by the writer.
+     * \remarks Pushing never blocks; once too much data is queued the worker reads the bytes
+     *          back from the file instead, which is still hot in the file system cache.
+     */
+    class HashPipeline
+    {
+        /**
+         * \brief Chunk of the file, either copied or to be read back from disk.
+         */
+        struct Job
+        {
+            int64_t offset{0};
+            int64_t length{0};
+            std::vector<char> data;
+        };
+
+        std::unique_ptr<Hasher> hasher;
+        std::filesystem::path file;
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable available;
+        std::deque<Job> queue;
+        size_t queuedBytes{0};
+        bool isClosed{false};
+        bool hasFailed{false};
+
+        void Run();
+        bool ReadBack(HANDLE handle, int64_t offset, int64_t length, std::vector<char>& buffer);
+
+    public:
+        HashPipeline(models::ChecksumAlgorithm algorithm, std::filesystem::path file);
+
+        HashPipeline(const HashPipeline&) = delete;
+        HashPipeline(HashPipeline&&) = delete;
+        HashPipeline& operator=(const HashPipeline&) = delete;
+        HashPipeline& operator=(HashPipeline&&) = delete;
+
+        ~HashPipeline();
+
+        /**
+         * \brief True if the algorithm is supported and hashing is running.
+         */
+        [[nodiscard]] bool IsValid() const { return hasher != nullptr; }
+
+        /**
+         * \brief Queues bytes just written to the file at the given offset.
+         */
+        void Push(const char* data, size_t length, int64_t offset);
+
+        /**
+         * \brief Queues a range already present in the file.
+         */
+        void PushFileRange(int64_t offset, int64_t length);
+
+        /**
+         * \brief Waits for all queued data to be hashed.
+         * \return The binary digest or empty on error.
+         */
+        std::optional<std::vector<uint8_t>> Finish();
+    };
+}
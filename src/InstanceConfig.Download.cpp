@@ -45,4 +45,15 @@ bool models::InstanceConfig::DownloadReleaseAsync(int releaseIndex, curl_progres
 void models::InstanceConfig::ResetReleaseDownloadState()
 {
 	downloadTask.reset();
+	isDownloadCancelled = false;
+}
+
+void models::InstanceConfig::CancelReleaseDownload()
+{
+	isDownloadCancelled = true;
+
+	if (downloadTask.has_value())
+	{
+		(*downloadTask).wait();
+	}
 }
@@ -0,0 +1,385 @@
+#include "pch.h"
+#include "Common.h"
+#include "InstanceConfig.hpp"
+#include "Hashing.hpp"
+#include "ConnectionPool.hpp"
+#include "FeedCache.hpp"
+
+
+namespace
+{
+    /**
+     * \brief Calculates the binary digest of the given content.
+     */
+    std::optional<std::vector<uint8_t>> GetDigest(const models::ChecksumAlgorithm algorithm, const std::string& content)
+    {
+        const auto hasher = hashing::CreateHasher(algorithm);
+
+        if (hasher == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        hasher->Update(content.data(), content.size());
+
+        return hasher->Finalize();
+    }
+
+    /**
+     * \brief Checks the content against the expected checksum.
+     */
+    bool IsChecksumMatching(const std::string& content, const models::ChecksumParameters& checksum)
+    {
+        std::vector<uint8_t> expected;
+
+        if (!hashing::ParseHexDigest(util::trim(checksum.checksum), expected))
+        {
+            return false;
+        }
+
+        const auto digest = GetDigest(checksum.checksumAlg, content);
+
+        return digest.has_value() && digest.value() == expected;
+    }
+
+    size_t WriteCallback(char* data, size_t size, size_t nmemb, void* userdata)
+    {
+        static_cast<std::string*>(userdata)->append(data, size * nmemb);
+        return size * nmemb;
+    }
+
+    size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+    {
+        auto* headers = static_cast<std::map<std::string, std::string>*>(userdata);
+        const auto bytes = size * nitems;
+        const std::string line(buffer, bytes);
+
+        // each new status line (e.g. after a redirect) starts a new set of headers
+        if (line.starts_with("HTTP/"))
+        {
+            headers->clear();
+        }
+        else if (const auto colon = line.find(':'); colon != std::string::npos)
+        {
+            (*headers)[util::trim(line.substr(0, colon))] = util::trim(line.substr(colon + 1), " \t\r\n");
+        }
+
+        return bytes;
+    }
+
+    /**
+     * \brief Looks up a response header, names are case-insensitive.
+     */
+    std::string GetHeaderValue(const std::map<std::string, std::string>& headers, const std::string& name)
+    {
+        const auto header = std::ranges::find_if(headers, [&name](const auto& entry)
+        {
+            return util::icompare(entry.first, name);
+        });
+
+        return header == headers.end() ? std::string{} : header->second;
+    }
+
+    int64_t GetUnixTime()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::optional<models::FeedCache> LoadValidators(const std::filesystem::path& validatorsFile)
+    {
+        std::error_code ec;
+
+        if (!exists(validatorsFile, ec))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            std::ifstream stream(validatorsFile, std::ios::binary);
+            const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+
+            return json::from_cbor(content).get<models::FeedCache>();
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to read summary validators {}, error {}", validatorsFile.string(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    /**
+     * \brief Performs a GET request over a pooled connection.
+     * \return The HTTP status code or a CURLcode on transport errors, the body and the response headers.
+     */
+    std::tuple<int, std::string, std::map<std::string, std::string>> GetText(
+        const std::string& url, const std::string& userAgent, const std::map<std::string, std::string>& headers)
+    {
+        auto& pool = net::ConnectionPool::Instance();
+        CURL* curl = pool.Acquire();
+
+        if (curl == nullptr)
+        {
+            return std::make_tuple(static_cast<int>(CURLE_FAILED_INIT), std::string{},
+                                   std::map<std::string, std::string>{});
+        }
+
+        curl_slist* headerList = nullptr;
+
+        for (const auto& [name, value] : headers)
+        {
+            headerList = curl_slist_append(headerList, std::format("{}: {}", name, value).c_str());
+        }
+
+        std::string body;
+        std::map<std::string, std::string> responseHeaders;
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, userAgent.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &responseHeaders);
+
+        const CURLcode result = pool.Perform(curl);
+        long code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+
+        pool.Release(curl);
+        curl_slist_free_all(headerList);
+
+        return std::make_tuple(result != CURLE_OK ? static_cast<int>(result) : static_cast<int>(code), body,
+                               responseHeaders);
+    }
+}
+
+std::string models::InstanceConfig::FetchReleaseSummary(
+    const std::string& url, const std::optional<ChecksumParameters>& checksum) const
+{
+    // the checksum identifies the content, otherwise fall back to the location
+    std::string cacheKey;
+    const bool isContentAddressed = [&]
+    {
+        std::vector<uint8_t> digest;
+
+        if (!checksum.has_value() || !hashing::ParseHexDigest(util::trim(checksum.value().checksum), digest))
+        {
+            return false;
+        }
+
+        cacheKey = hashing::ToHexDigest(digest);
+        return true;
+    }();
+
+    if (!isContentAddressed)
+    {
+        cacheKey = hashing::ToHexDigest(GetDigest(ChecksumAlgorithm::SHA256, url).value());
+    }
+
+    const auto localData = GetLocalDataPath();
+    const auto cacheFile = localData.empty()
+                               ? std::filesystem::path{}
+                               : localData / "summaries" / std::format("{}.md", cacheKey);
+    // content at a plain URL may change, so it's only reused as long as the server says so
+    const auto validatorsFile = cacheFile.empty() || isContentAddressed
+                                    ? std::filesystem::path{}
+                                    : localData / "summaries" / std::format("{}.cbor", cacheKey);
+
+    std::optional<std::string> cached;
+    auto validators = validatorsFile.empty() ? std::nullopt : LoadValidators(validatorsFile);
+
+    if (validators.has_value() && validators.value().url != url)
+    {
+        validators.reset();
+    }
+
+    if (std::error_code ec; !cacheFile.empty() && exists(cacheFile, ec) &&
+        (isContentAddressed || validators.has_value()))
+    {
+        std::ifstream stream(cacheFile, std::ios::binary);
+        std::string content(std::istreambuf_iterator<char>(stream), {});
+
+        if (!checksum.has_value() || IsChecksumMatching(content, checksum.value()))
+        {
+            if (isContentAddressed || validators.value().IsFresh())
+            {
+                spdlog::debug("Using cached summary {}", cacheFile.string());
+                return content;
+            }
+
+            cached = std::move(content);
+        }
+        else
+        {
+            spdlog::warn("Cached summary {} is corrupted, fetching again", cacheFile.string());
+        }
+    }
+
+    auto headers = GetCommonHeaders();
+    headers["Accept"] = "text/markdown, text/plain";
+
+    // a stale copy may still be current, let the server tell
+    if (cached.has_value())
+    {
+        if (!validators.value().etag.empty())
+        {
+            headers["If-None-Match"] = validators.value().etag;
+        }
+
+        if (!validators.value().lastModified.empty())
+        {
+            headers["If-Modified-Since"] = validators.value().lastModified;
+        }
+    }
+
+    auto [code, body, responseHeaders] = GetText(url, std::format("{}/{}", appFilename, appVersion.ToString()),
+                                                 headers);
+    const auto maxAge = models::FeedCache::GetMaxAge(GetHeaderValue(responseHeaders, "Cache-Control"),
+                                                     GetHeaderValue(responseHeaders, "Age"));
+
+    if (code == 304 && cached.has_value())
+    {
+        spdlog::debug("Summary {} not modified, using cached copy", url);
+
+        auto& revalidated = validators.value();
+        revalidated.storedAt = GetUnixTime();
+        revalidated.maxAge = std::max<int64_t>(maxAge, 0);
+
+        try
+        {
+            const auto content = json::to_cbor(json(revalidated));
+            util::WriteFileAtomically(validatorsFile, content.data(), content.size());
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to update summary validators, error {}", e.what());
+        }
+
+        return cached.value();
+    }
+
+    if (code != 200)
+    {
+        spdlog::error("GET request for summary {} failed with code {}", url, code);
+        return {};
+    }
+
+    if (checksum.has_value() && !IsChecksumMatching(body, checksum.value()))
+    {
+        spdlog::error("Summary {} doesn't match the expected checksum", url);
+        return {};
+    }
+
+    if (!cacheFile.empty())
+    {
+        try
+        {
+            create_directories(cacheFile.parent_path());
+
+            if (isContentAddressed)
+            {
+                util::WriteFileAtomically(cacheFile, body.data(), body.size());
+            }
+            else
+            {
+                FeedCache updated;
+                updated.url = url;
+                updated.etag = GetHeaderValue(responseHeaders, "ETag");
+                updated.lastModified = GetHeaderValue(responseHeaders, "Last-Modified");
+                updated.storedAt = GetUnixTime();
+                updated.maxAge = maxAge;
+
+                std::error_code ec;
+                std::filesystem::remove(validatorsFile, ec);
+
+                // nothing to gain from a response that can neither stay fresh nor be revalidated
+                if (maxAge >= 0 && (updated.maxAge > 0 || updated.CanRevalidate()))
+                {
+                    // the validators are written last, so they never describe a stale or partial body
+                    util::WriteFileAtomically(cacheFile, body.data(), body.size());
+
+                    const auto content = json::to_cbor(json(updated));
+                    util::WriteFileAtomically(validatorsFile, content.data(), content.size());
+                }
+                else
+                {
+                    std::filesystem::remove(cacheFile, ec);
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to cache summary, error {}", e.what());
+        }
+    }
+
+    return body;
+}
+
+void models::InstanceConfig::PrefetchReleaseSummary()
+{
+    if (remote.releases.GetEnabledCount() == 0 || summaryTask.has_value())
+    {
+        return;
+    }
+
+    const auto& release = GetSelectedRelease();
+
+    if (!release.summary.empty() || !release.summaryUrl.has_value())
+    {
+        return;
+    }
+
+    spdlog::debug("Fetching summary from {}", release.summaryUrl.value());
+
+    summaryTaskRelease = selectedRelease;
+    summaryTask = std::async(
+        std::launch::async,
+        &InstanceConfig::FetchReleaseSummary,
+        this,
+        release.summaryUrl.value(),
+        release.summaryChecksum
+    );
+}
+
+bool models::InstanceConfig::IsReleaseSummaryAvailable()
+{
+    if (remote.releases.GetEnabledCount() == 0)
+    {
+        return true;
+    }
+
+    // hand over a finished download, even if it was meant for a previously selected release
+    if (summaryTask.has_value() &&
+        (*summaryTask).wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)
+    {
+        auto& release = materializedReleases.at(summaryTaskRelease);
+        release.summary = (*summaryTask).get();
+
+        if (release.summary.empty())
+        {
+            release.summary = std::format("*The summary couldn't be loaded*, see [{0}]({0})",
+                                          release.summaryUrl.value());
+        }
+
+        summaryTask.reset();
+    }
+
+    const auto& release = GetSelectedRelease();
+
+    if (!release.summary.empty() || !release.summaryUrl.has_value())
+    {
+        return true;
+    }
+
+    PrefetchReleaseSummary();
+
+    return false;
+}
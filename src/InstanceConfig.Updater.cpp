@@ -97,6 +97,15 @@ bool models::InstanceConfig::RunSelfUpdater() const
 			<< " --pid " << GetCurrentProcessId()
 			<< " --path \"" << appPath.string() << "\""
 			<< " --url \"" << remote.instance.value().latestUrl.value() << "\"";
+
+		// the self-updater verifies the new binary before replacing us with it
+		if (const auto& checksum = remote.instance.value().latestChecksum; checksum.has_value())
+		{
+			argsStream
+				<< " --checksum " << util::trim(checksum.value().checksum)
+				<< " --checksum-alg " << magic_enum::enum_name(checksum.value().checksumAlg);
+		}
+
 		const auto args = argsStream.str();
 		spdlog::debug("args = {}", args);
 
@@ -138,6 +147,15 @@ bool models::InstanceConfig::RunSelfUpdater() const
 			<< " --pid " << GetCurrentProcessId()
 			<< " --path \"" << appPath.string() << "\""
 			<< " --url \"" << remote.instance.value().latestUrl.value() << "\"";
+
+		// the self-updater verifies the new binary before replacing us with it
+		if (const auto& checksum = remote.instance.value().latestChecksum; checksum.has_value())
+		{
+			argsStream
+				<< " --checksum " << util::trim(checksum.value().checksum)
+				<< " --checksum-alg " << magic_enum::enum_name(checksum.value().checksumAlg);
+		}
+
 		const auto args = argsStream.str();
 		spdlog::debug("args = {}", args);
 
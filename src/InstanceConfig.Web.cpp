@@ -1,102 +1,607 @@
 #include "pch.h"
+#include "Common.h"
 #include "InstanceConfig.hpp"
+#include "Downloader.hpp"
+#include "FeedCache.hpp"
+#include "FeedReader.hpp"
+#include "MirrorHistory.hpp"
 #define _CRT_SECURE_NO_WARNINGS
 
 
-void models::InstanceConfig::SetCommonHeaders(RestClient::Connection* conn) const
+namespace
 {
+    int64_t GetUnixTime()
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * \brief Looks up a response header, names are case-insensitive.
+     */
+    std::string GetHeaderValue(const RestClient::HeaderFields& headers, const std::string& name)
+    {
+        const auto header = std::ranges::find_if(headers, [&name](const auto& entry)
+        {
+            return util::icompare(entry.first, name);
+        });
+
+        return header == headers.end() ? std::string{} : util::trim(header->second, " \t\r\n");
+    }
+
+    /**
+     * \brief Lists the locations the update information is looked for, in order of preference.
+     * \param url The update information URL.
+     * \param preferredUrl The location that served the update information last time.
+     */
+    std::vector<std::pair<std::string, net::FeedCompression>> GetFeedSources(
+        const std::string& url, const std::string& preferredUrl)
+    {
+        std::vector<std::pair<std::string, net::FeedCompression>> sources;
+
+#if defined(NV_FLAGS_PRECOMPRESSED_FEED)
+        // static hosts don't compress on the fly, but may provide compressed copies next to the file
+        for (const auto compression : {net::FeedCompression::Zstd, net::FeedCompression::Gzip})
+        {
+            if (auto sibling = net::FeedReader::GetPrecompressedUrl(url, compression); !sibling.empty())
+            {
+                sources.emplace_back(std::move(sibling), compression);
+            }
+        }
+#endif
+
+        sources.emplace_back(url, net::FeedCompression::None);
+
+        // skip probing for locations known to be missing
+        const auto preferred = std::ranges::find(sources, preferredUrl, [](const auto& source)
+        {
+            return source.first;
+        });
+
+        if (preferred != sources.end())
+        {
+            std::rotate(sources.begin(), preferred, preferred + 1);
+        }
+
+        return sources;
+    }
+
+    /**
+     * \brief Gets the remaining freshness lifetime of a response.
+     * \return The lifetime in seconds, 0 if the response must be revalidated, -1 if it must not be stored.
+     */
+    int64_t GetMaxAge(const RestClient::HeaderFields& headers)
+    {
+        return models::FeedCache::GetMaxAge(GetHeaderValue(headers, "Cache-Control"), GetHeaderValue(headers, "Age"));
+    }
+
+    std::optional<models::FeedCache> LoadFeedCache(const std::filesystem::path& cacheFile)
+    {
+        std::error_code ec;
+
+        if (cacheFile.empty() || !exists(cacheFile, ec))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            std::ifstream stream(cacheFile, std::ios::binary);
+            const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+
+            return json::from_cbor(content).get<models::FeedCache>();
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to read feed cache {}, error {}", cacheFile.string(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    void SaveFeedCache(const std::filesystem::path& cacheFile, const models::FeedCache& cache)
+    {
+        if (cacheFile.empty())
+        {
+            return;
+        }
+
+        try
+        {
+            const auto content = json::to_cbor(json(cache));
+
+            util::WriteFileAtomically(cacheFile, content.data(), content.size());
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to persist feed cache, error {}", e.what());
+        }
+    }
+
+    /** Bumped whenever the layout of the stored model changes, files of other versions are ignored */
+    constexpr int FeedModelFormat = 1;
+
+    /**
+     * \brief Reads the update information deserialized by an earlier run.
+     * \param modelFile Full pathname of the stored model.
+     * \param cache The validators of the cached response the model has to belong to.
+     * \return The update information or empty if the model is missing, outdated or damaged.
+     */
+    std::optional<models::UpdateResponse> LoadFeedModel(const std::filesystem::path& modelFile,
+                                                        const models::FeedCache& cache)
+    {
+        std::error_code ec;
+
+        if (modelFile.empty() || !exists(modelFile, ec))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            std::ifstream stream(modelFile, std::ios::binary);
+            const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+            const auto model = json::from_cbor(content);
+
+            if (model.at("format") != FeedModelFormat || model.at("etag") != cache.etag ||
+                model.at("lastModified") != cache.lastModified)
+            {
+                return std::nullopt;
+            }
+
+            models::UpdateResponse response;
+            response.instance = model.at("instance").get<std::optional<models::UpdateConfig>>();
+            response.shared = model.at("shared").get<std::optional<models::SharedConfig>>();
+
+            if (!response.releases.FromSnapshot(model.at("releases")))
+            {
+                spdlog::warn("Stored update information model {} is damaged", modelFile.string());
+                return std::nullopt;
+            }
+
+            return response;
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to read update information model {}, error {}", modelFile.string(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    /**
+     * \brief Persists the deserialized update information, so later runs skip parsing the body.
+     * \param modelFile Full pathname of the stored model.
+     * \param cache The validators of the cached response the model belongs to.
+     * \param response The deserialized update information.
+     */
+    void SaveFeedModel(const std::filesystem::path& modelFile, const models::FeedCache& cache,
+                       const models::UpdateResponse& response)
+    {
+        if (modelFile.empty())
+        {
+            return;
+        }
+
+        try
+        {
+            const json model = {
+                {"format", FeedModelFormat},
+                {"etag", cache.etag},
+                {"lastModified", cache.lastModified},
+                {"instance", response.instance},
+                {"shared", response.shared},
+                {"releases", response.releases.ToSnapshot()}
+            };
+            const auto content = json::to_cbor(model);
+
+            util::WriteFileAtomically(modelFile, content.data(), content.size());
+        }
+        catch (const std::exception& e)
+        {
+            // a model of an older response must not outlive it
+            std::error_code ec;
+            std::filesystem::remove(modelFile, ec);
+
+            spdlog::warn("Failed to persist update information model, error {}", e.what());
+        }
+    }
+
+    std::optional<models::MirrorHistory> LoadMirrorHistory(const std::filesystem::path& historyFile)
+    {
+        std::error_code ec;
+
+        if (historyFile.empty() || !exists(historyFile, ec))
+        {
+            return std::nullopt;
+        }
+
+        try
+        {
+            std::ifstream stream(historyFile, std::ios::binary);
+            const std::vector<uint8_t> content(std::istreambuf_iterator<char>(stream), {});
+
+            return json::from_cbor(content).get<models::MirrorHistory>();
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to read mirror history {}, error {}", historyFile.string(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    void SaveMirrorHistory(const std::filesystem::path& historyFile, const models::MirrorHistory& history)
+    {
+        if (historyFile.empty())
+        {
+            return;
+        }
+
+        try
+        {
+            create_directories(historyFile.parent_path());
+
+            const auto content = json::to_cbor(json(history));
+
+            util::WriteFileAtomically(historyFile, content.data(), content.size());
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::warn("Failed to persist mirror history, error {}", e.what());
+        }
+    }
+
+    /**
+     * \brief A request for the update information to one mirror, possibly racing others.
+     */
+    struct FeedAttempt
+    {
+        /** The mirror's update information URL */
+        std::string mirrorUrl;
+        /** The request as last sent, its URL is the location that answered */
+        net::FeedRequest request;
+        models::UpdateResponse response;
+        net::FeedResult result;
+        /** Set once another mirror answered first */
+        std::atomic<bool> isCancelled{false};
+        /** Set once the request finished, guarded by the hedge lock */
+        bool isDone{false};
+        /** Time from this attempt's launch until it finished */
+        std::chrono::milliseconds elapsed{0};
+        std::chrono::steady_clock::time_point finishedAt;
+        std::future<void> task;
+
+        [[nodiscard]] bool IsSuccess() const
+        {
+            return result.code == 304 || (result.code == 200 && result.isParsed);
+        }
+    };
+
+    /**
+     * \brief Requests the update information from one mirror, trying its precompressed variants first.
+     */
+    void FetchFromSources(FeedAttempt& attempt, const std::optional<models::FeedCache>& cache,
+                          const std::string& cachedSourceUrl)
+    {
+        auto& request = attempt.request;
+
+        for (const auto& [url, compression] : GetFeedSources(attempt.mirrorUrl, cachedSourceUrl))
+        {
+            request.url = url;
+            request.compression = compression;
+            request.headers.erase("If-None-Match");
+            request.headers.erase("If-Modified-Since");
+
+            // let the server tell us that nothing has changed
+            if (cache.has_value() && url == cachedSourceUrl)
+            {
+                if (!cache.value().etag.empty())
+                    request.headers["If-None-Match"] = cache.value().etag;
+
+                if (!cache.value().lastModified.empty())
+                    request.headers["If-Modified-Since"] = cache.value().lastModified;
+            }
+
+            attempt.response = models::UpdateResponse{};
+            attempt.result = net::FeedReader::Fetch(request, attempt.response);
+
+            // static hosts answer 403 or 404 for files that don't exist, anything else is final
+            if (attempt.result.code != 403 && attempt.result.code != 404)
+            {
+                break;
+            }
+
+            spdlog::debug("Update information not available at {}, code {}", url, attempt.result.code);
+        }
+    }
+
+    /**
+     * \brief Requests the update information from the mirrors, starting with the first one.
+     * \remarks If a mirror takes longer than the hedge delay or fails, the next one gets started and the
+     *          first successful answer wins, the others are cancelled. At most two requests run at once.
+     * \param mirrors The mirror URLs in order of preference.
+     * \param request The request parameters, the body of the winner ends up in its body file.
+     * \param history Receives the performance of every mirror asked.
+     * \return The winning attempt, the first one if all of them failed.
+     */
+    std::unique_ptr<FeedAttempt> FetchFromMirrors(const std::vector<std::string>& mirrors,
+                                                  const net::FeedRequest& request,
+                                                  const std::optional<models::FeedCache>& cache,
+                                                  const std::string& cachedSourceUrl,
+                                                  models::MirrorHistory& history)
+    {
+        std::mutex lock;
+        std::condition_variable finished;
+        std::vector<std::unique_ptr<FeedAttempt>> attempts;
+        const auto raceStarted = std::chrono::steady_clock::now();
+        auto lastLaunch = raceStarted;
+
+        const auto launch = [&]()
+        {
+            const auto index = attempts.size();
+            auto& attempt = *attempts.emplace_back(std::make_unique<FeedAttempt>());
+
+            attempt.mirrorUrl = mirrors[index];
+            attempt.request = request;
+            attempt.request.isCancelled = &attempt.isCancelled;
+
+            // every contestant streams to its own file, only the winner's is kept
+            if (!request.bodyFile.empty())
+            {
+                attempt.request.bodyFile += std::format(".{}", index);
+            }
+
+            if (index > 0)
+            {
+                spdlog::info("Racing mirror {}", attempt.mirrorUrl);
+            }
+
+            lastLaunch = std::chrono::steady_clock::now();
+
+            attempt.task = std::async(std::launch::async, [&, &attempt = attempt, started = lastLaunch]
+            {
+                FetchFromSources(attempt, cache, cachedSourceUrl);
+
+                std::lock_guard guard(lock);
+                attempt.finishedAt = std::chrono::steady_clock::now();
+                attempt.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(attempt.finishedAt - started);
+                attempt.isDone = true;
+                finished.notify_all();
+            });
+        };
+
+        FeedAttempt* winner = nullptr;
+
+        launch();
+
+        {
+            std::unique_lock guard(lock);
+
+            while (winner == nullptr)
+            {
+                const auto running = std::ranges::count_if(attempts, [](const auto& a) { return !a->isDone; });
+                const auto done = std::ranges::find_if(attempts, [](const auto& a)
+                {
+                    return a->isDone && a->IsSuccess();
+                });
+
+                if (done != attempts.end())
+                {
+                    winner = done->get();
+                    break;
+                }
+
+                const bool hasMore = attempts.size() < mirrors.size();
+                const auto hedgeAt = lastLaunch + std::chrono::milliseconds(NV_FEED_HEDGE_DELAY);
+
+                // all failed so far or the ones in flight are too slow
+                if (hasMore && (running == 0 || (running < 2 && std::chrono::steady_clock::now() >= hedgeAt)))
+                {
+                    launch();
+                    continue;
+                }
+
+                if (running == 0)
+                {
+                    break;
+                }
+
+                if (hasMore && running < 2)
+                {
+                    finished.wait_until(guard, hedgeAt);
+                }
+                else
+                {
+                    finished.wait(guard);
+                }
+            }
+        }
+
+        for (auto& attempt : attempts)
+        {
+            if (attempt.get() != winner)
+            {
+                attempt->isCancelled = true;
+            }
+        }
+
+        for (auto& attempt : attempts)
+        {
+            attempt->task.wait();
+
+            // a cancelled loser only tells that it didn't beat the winner, hedges started late would
+            // otherwise look faster than the mirror that actually answered first
+            if (attempt->isCancelled && attempt->result.code == CURLE_ABORTED_BY_CALLBACK && winner != nullptr)
+            {
+                history.RecordLowerBound(attempt->mirrorUrl, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             winner->finishedAt - raceStarted));
+            }
+            else
+            {
+                history.Record(attempt->mirrorUrl, attempt->IsSuccess(), attempt->elapsed);
+            }
+
+            if (attempt.get() != winner && !attempt->request.bodyFile.empty())
+            {
+                std::error_code ec;
+                std::filesystem::remove(attempt->request.bodyFile, ec);
+            }
+        }
+
+        if (winner == nullptr)
+        {
+            return std::move(attempts.front());
+        }
+
+        if (!request.bodyFile.empty())
+        {
+            std::error_code ec;
+            std::filesystem::rename(winner->request.bodyFile, request.bodyFile, ec);
+        }
+
+        if (winner != attempts.front().get())
+        {
+            spdlog::info("Mirror {} answered first", winner->mirrorUrl);
+        }
+
+        return std::move(*std::ranges::find(attempts, winner, &std::unique_ptr<FeedAttempt>::get));
+    }
+}
+
+
+RestClient::HeaderFields models::InstanceConfig::GetCommonHeaders() const
+{
+    RestClient::HeaderFields headers;
+
     //
     // If a backend server is used, it can alter the response based on 
     // these header values, classic web servers will just ignore them
     // 
 
 #if !defined(NV_FLAGS_NO_VENDOR_HEADERS)
-    conn->AppendHeader("X-" NV_HTTP_HEADERS_NAME "-Manufacturer", manufacturer);
-    conn->AppendHeader("X-" NV_HTTP_HEADERS_NAME "-Product", product);
-    conn->AppendHeader("X-" NV_HTTP_HEADERS_NAME "-Version", appVersion.to_string());
+    headers["X-" NV_HTTP_HEADERS_NAME "-Manufacturer"] = manufacturer;
+    headers["X-" NV_HTTP_HEADERS_NAME "-Product"] = product;
+    headers["X-" NV_HTTP_HEADERS_NAME "-Version"] = appVersion.ToString();
 #endif
+
+    return headers;
 }
 
 int models::InstanceConfig::DownloadRelease(curl_progress_callback progressFn, const int releaseIndex)
 {
-    const auto conn = new RestClient::Connection("");
-
-    conn->SetTimeout(5);
-    const auto ua = std::format("{}/{}", appFilename, appVersion.to_string());
+    const auto ua = std::format("{}/{}", appFilename, appVersion.ToString());
     spdlog::debug("Setting User Agent to {}", ua);
-    conn->SetUserAgent(ua);
-    conn->FollowRedirects(true);
-    conn->FollowRedirects(true, 5);
-    conn->SetFileProgressCallback(progressFn);
-
-    SetCommonHeaders(conn);
 
-    // pre-allocate buffers
-    std::string tempPath(MAX_PATH, '\0');
-    std::string tempFile(MAX_PATH, '\0');
+    auto& release = GetSelectedRelease();
+    const auto localData = GetLocalDataPath();
+    const auto stateFile = localData.empty() ? std::filesystem::path{} : localData / "download.json";
+    auto resumeState = net::Downloader::LoadState(stateFile);
 
-    if (GetTempPathA(MAX_PATH, tempPath.data()) == 0)
+    // a different release was left behind, it's of no use anymore
+    if (resumeState.has_value() &&
+        (resumeState.value().url != release.downloadUrl || !std::filesystem::exists(resumeState.value().tempFile)))
     {
-        spdlog::error("Failed to get path to temporary directory, error", GetLastError());
-        return -1;
+        DeleteFileA(resumeState.value().tempFile.c_str());
+        resumeState.reset();
     }
 
-    spdlog::debug("tempPath = {}", tempPath);
-
-    if (GetTempFileNameA(tempPath.c_str(), "VICIUS", 0, tempFile.data()) == 0)
+    if (resumeState.has_value())
     {
-        spdlog::error("Failed to get temporary file name, error", GetLastError());
-        return -1;
+        release.localTempFilePath = resumeState.value().tempFile;
     }
+    else
+    {
+        // pre-allocate buffers
+        std::string tempPath(MAX_PATH, '\0');
+        std::string tempFile(MAX_PATH, '\0');
 
-    // strip redundant NULLs
-    tempFile.erase(std::ranges::find(tempFile, '\0'), tempFile.end());
-
-    spdlog::debug("tempFile = {}", tempFile);
+        if (GetTempPathA(MAX_PATH, tempPath.data()) == 0)
+        {
+            spdlog::error("Failed to get path to temporary directory, error", GetLastError());
+            return -1;
+        }
 
-    auto& release = GetSelectedRelease();
-    release.localTempFilePath = tempFile;
+        spdlog::debug("tempPath = {}", tempPath);
 
-    // this is ugly but only one download can run in parallel so we're fine :)
-    static std::ofstream outStream;
+        if (GetTempFileNameA(tempPath.c_str(), "VICIUS", 0, tempFile.data()) == 0)
+        {
+            spdlog::error("Failed to get temporary file name, error", GetLastError());
+            return -1;
+        }
 
-    const std::ios_base::iostate exceptionMask = outStream.exceptions() | std::ios::failbit;
-    outStream.exceptions(exceptionMask);
+        // strip redundant NULLs
+        tempFile.erase(std::ranges::find(tempFile, '\0'), tempFile.end());
 
-    try
-    {
-        outStream.open(release.localTempFilePath.string(), std::ios::binary);
+        release.localTempFilePath = tempFile;
     }
-    catch (std::ios_base::failure& e)
+
+    spdlog::debug("tempFile = {}", release.localTempFilePath.string());
+
+    const auto historyFile = localData.empty() ? std::filesystem::path{} : localData / "mirrors.cbor";
+    auto history = LoadMirrorHistory(historyFile).value_or(models::MirrorHistory{});
+
+    net::DownloadOptions options;
+    options.url = release.downloadUrl;
+    options.mirrorUrls = release.downloadMirrors;
+    options.history = &history;
+    options.targetFile = release.localTempFilePath;
+    options.userAgent = ua;
+    options.headers = GetCommonHeaders();
+    options.expectedSize = release.downloadSize;
+    options.progressFn = progressFn;
+    options.stateFile = stateFile;
+    options.resumeState = std::move(resumeState);
+    options.isCancelled = &isDownloadCancelled;
+    options.connectTimeout = downloadTimeouts.connectTimeout.value_or(NV_DOWNLOAD_CONNECT_TIMEOUT);
+    options.lowSpeedLimit = downloadTimeouts.lowSpeedLimit.value_or(NV_DOWNLOAD_LOW_SPEED_LIMIT);
+    options.lowSpeedTime = downloadTimeouts.lowSpeedTime.value_or(NV_DOWNLOAD_LOW_SPEED_TIME);
+    options.idleTimeout = downloadTimeouts.idleTimeout.value_or(NV_DOWNLOAD_IDLE_TIMEOUT);
+
+    if (release.checksum.has_value())
     {
-        spdlog::error("Failed to open file {}, error {}",
-                      release.localTempFilePath.string(), e.what());
-        return -1;
+        options.checksum = release.checksum.value().checksum;
+        options.checksumAlg = release.checksum.value().checksumAlg;
     }
 
-    // write to file as we download it
-    auto writeCallback = [](void* data, size_t size, size_t nmemb, void* userdata) -> size_t
+#if defined(NV_FLAGS_NO_SEGMENTED_DOWNLOAD)
+    options.maxConnections = 1;
+#endif
+
+    net::RetryPolicy retry(
+        NV_DOWNLOAD_RETRY_ATTEMPTS,
+        std::chrono::milliseconds(NV_RETRY_BASE_DELAY),
+        std::chrono::milliseconds(NV_RETRY_MAX_DELAY)
+    );
+
+    int code;
+
+    while (true)
     {
-        UNREFERENCED_PARAMETER(userdata);
+        net::Downloader downloader(options);
 
-        const auto bytes = size * nmemb;
+        code = downloader.Run();
+        release.isChecksumValid = downloader.IsChecksumValid();
 
-        // TODO: error handling
-        outStream.write(static_cast<char*>(data), bytes);
+        if (code == 200)
+        {
+            break;
+        }
 
-        return bytes;
-    };
+        spdlog::error("GET request failed with code {}", code);
 
-    conn->SetWriteFunction(writeCallback);
+        if (!retry.Wait(code, downloader.GetRetryAfter(), &isDownloadCancelled))
+        {
+            break;
+        }
 
-    auto [code, body, _] = conn->get(release.downloadUrl);
+        // pick up where the failed attempt left off, if the server allows
+        options.resumeState = net::Downloader::LoadState(stateFile);
+    }
 
-    outStream.close();
+    SaveMirrorHistory(historyFile, history);
 
-    // TODO: error handling, retry?
-    if (code != 200)
+    // never leave a tampered or corrupted setup around
+    if (code == 200 && release.isChecksumValid.has_value() && !release.isChecksumValid.value())
     {
-        spdlog::error("GET request failed with code {}", code);
+        DeleteFileA(release.localTempFilePath.string().c_str());
     }
 
     return code;
@@ -104,53 +609,197 @@ int models::InstanceConfig::DownloadRelease(curl_progress_callback progressFn, c
 
 [[nodiscard]] std::tuple<bool, std::string> models::InstanceConfig::RequestUpdateInfo()
 {
-    const auto conn = new RestClient::Connection("");
+#if defined(NV_FLAGS_NO_FEED_CACHE)
+    const std::filesystem::path cacheFile, bodyFile, modelFile;
+#else
+    const auto localData = GetLocalDataPath();
+    const auto cacheFile = localData.empty() ? std::filesystem::path{} : localData / "feed.cbor";
+    const auto bodyFile = localData.empty() ? std::filesystem::path{} : localData / "feed.body";
+    const auto modelFile = localData.empty() ? std::filesystem::path{} : localData / "feed.model";
+#endif
+    auto cache = LoadFeedCache(cacheFile);
 
-    conn->SetTimeout(5);
-    const auto ua = std::format("{}/{}", appFilename, appVersion.to_string());
-    spdlog::debug("Setting User Agent to {}", ua);
-    conn->SetUserAgent(ua);
-    conn->FollowRedirects(true);
-    conn->FollowRedirects(true, 5);
+    // the stored model spares parsing the body, which stays around in case the model can't be used
+    const auto ReadCachedResponse = [&bodyFile, &modelFile](const FeedCache& cached, UpdateResponse& response,
+                                                            std::string& error)
+    {
+        if (auto model = LoadFeedModel(modelFile, cached); model.has_value())
+        {
+            response = std::move(model.value());
+            return true;
+        }
 
-    RestClient::HeaderFields headers;
-    headers["Accept"] = "application/json";
-    conn->SetHeaders(headers);
+        if (!net::FeedReader::ReadFile(bodyFile, net::FeedReader::GetEncoding(cached.contentType), response, error))
+        {
+            return false;
+        }
 
-    SetCommonHeaders(conn);
+        SaveFeedModel(modelFile, cached, response);
 
-    auto [code, body, _] = conn->get(updateRequestUrl);
+        return true;
+    };
 
-    if (code != 200)
+    // the cached response belongs to a different server/product or is gone
+    if (cache.has_value() && (cache.value().url != updateRequestUrl || !std::filesystem::exists(bodyFile)))
     {
-        // TODO: add retry logic or similar
+        cache.reset();
+    }
 
-        spdlog::error("GET request failed with code {}", code);
-        const auto curlCode = magic_enum::enum_name<CURLcode>(static_cast<CURLcode>(code));
+    if (cache.has_value() && cache.value().IsFresh())
+    {
+        spdlog::info("Cached update information is still fresh, skipping request");
+
+        UpdateResponse cached;
+        std::string error;
+
+        if (ReadCachedResponse(cache.value(), cached, error))
+        {
+            return ApplyUpdateResponse(std::move(cached));
+        }
+
+        spdlog::warn("Failed to read cached update information, error {}", error);
+        cache.reset();
+    }
+
+    net::FeedRequest request;
+    request.url = updateRequestUrl;
+    request.userAgent = std::format("{}/{}", appFilename, appVersion.ToString());
+    request.headers = GetCommonHeaders();
+    // binary encodings are smaller and cheaper to parse, servers not offering them answer with JSON
+    request.headers["Accept"] = net::FeedReader::AcceptedContentTypes;
+    request.timeout = 5;
+
+    spdlog::debug("Setting User Agent to {}", request.userAgent);
+
+    // the body is mirrored aside and only replaces the cached one once it turned out valid
+    auto pendingBodyFile = bodyFile;
+
+    if (!bodyFile.empty())
+    {
+        pendingBodyFile += ".tmp";
+        request.bodyFile = pendingBodyFile;
+    }
+
+    auto discardPendingBody = sg::make_scope_guard([&pendingBodyFile]() noexcept
+    {
+        std::error_code ec;
+        std::filesystem::remove(pendingBodyFile, ec);
+    });
+
+    const auto cachedSourceUrl = cache.has_value() && !cache.value().sourceUrl.empty()
+                                     ? cache.value().sourceUrl
+                                     : updateRequestUrl;
+
+    const auto historyFile = bodyFile.empty() ? std::filesystem::path{} : bodyFile.parent_path() / "mirrors.cbor";
+    auto history = LoadMirrorHistory(historyFile).value_or(models::MirrorHistory{});
+
+    // the fastest mirror of earlier runs goes first
+    auto mirrors = updateRequestUrls.empty() ? std::vector{updateRequestUrl} : updateRequestUrls;
+    history.Rank(mirrors);
+
+    // keep the budget tight, the user might be waiting for the window to show up
+    net::RetryPolicy retry(
+        NV_FEED_RETRY_ATTEMPTS,
+        std::chrono::milliseconds(NV_RETRY_BASE_DELAY),
+        std::chrono::milliseconds(NV_RETRY_MAX_DELAY),
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::milliseconds(NV_RETRY_MAX_DELAY))
+    );
+
+    std::unique_ptr<FeedAttempt> attempt;
+
+    do
+    {
+        attempt = FetchFromMirrors(mirrors, request, cache, cachedSourceUrl, history);
+    }
+    while (!attempt->IsSuccess() && retry.Wait(attempt->result.code, net::RetryPolicy::ParseRetryAfter(
+        GetHeaderValue(attempt->result.headers, "Retry-After"))));
+
+    SaveMirrorHistory(historyFile, history);
+
+    const auto& result = attempt->result;
+    auto& response = attempt->response;
+    request.url = attempt->request.url;
+
+    if (result.code == 304 && cache.has_value())
+    {
+        spdlog::info("Update information not modified, using cached response");
+
+        auto& cached = cache.value();
+        cached.storedAt = GetUnixTime();
+        cached.maxAge = GetMaxAge(result.headers);
+        SaveFeedCache(cacheFile, cached);
+
+        UpdateResponse cachedResponse;
+        std::string error;
+
+        if (!ReadCachedResponse(cached, cachedResponse, error))
+        {
+            spdlog::error("Failed to read cached update information, error {}", error);
+            return std::make_tuple(false, std::format("JSON parsing error: {}", error));
+        }
+
+        return ApplyUpdateResponse(std::move(cachedResponse));
+    }
+
+    if (result.code != 200)
+    {
+        spdlog::error("GET request failed with code {}", result.code);
+        const auto curlCode = magic_enum::enum_name<CURLcode>(static_cast<CURLcode>(result.code));
         return std::make_tuple(false, std::format("HTTP error {}", curlCode));
     }
 
-    try
+    if (!result.isParsed)
     {
-        const json reply = json::parse(body);
-        remote = reply.get<UpdateResponse>();
+        spdlog::error("Failed to parse update information, error {}", result.error);
+        return std::make_tuple(false, std::format("Parsing error: {}", result.error));
+    }
+
+    if (const auto maxAge = GetMaxAge(result.headers); maxAge >= 0 && !bodyFile.empty())
+    {
+        FeedCache updated;
+        updated.url = updateRequestUrl;
+        updated.etag = GetHeaderValue(result.headers, "ETag");
+        updated.lastModified = GetHeaderValue(result.headers, "Last-Modified");
+        updated.sourceUrl = request.url;
+        updated.contentType = result.contentType;
+        updated.storedAt = GetUnixTime();
+        updated.maxAge = maxAge;
+
+        // nothing to gain from a response that can neither stay fresh nor be revalidated
+        if (updated.maxAge > 0 || updated.CanRevalidate())
+        {
+            std::error_code ec;
+            std::filesystem::rename(pendingBodyFile, bodyFile, ec);
 
-        // remove releases marked as disabled
-        std::erase_if(
-            remote.releases,
-            [](const UpdateRelease& x)
+            if (!ec)
             {
-                return x.disabled;
-            });
+                SaveFeedModel(modelFile, updated, response);
+                SaveFeedCache(cacheFile, updated);
+            }
+        }
+    }
+
+    return ApplyUpdateResponse(std::move(response));
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::ApplyUpdateResponse(UpdateResponse&& response)
+{
+    try
+    {
+        // releases are already ordered by version, disabled ones are skipped by the index
+        remote = std::move(response);
+        materializedReleases.clear();
+
+        spdlog::debug("Received {} releases, {} enabled", remote.releases.Size(), remote.releases.GetEnabledCount());
 
-        // top release is always latest by version, even if the response wasn't the right order
-        std::ranges::sort(remote.releases, [](const UpdateRelease& lhs, const UpdateRelease& rhs)
+        if (authority != Authority::Local && remote.instance.has_value() &&
+            remote.instance.value().downloadTimeouts.has_value())
         {
-            return lhs.GetSemVersion() > rhs.GetSemVersion();
-        });
+            downloadTimeouts.Merge(remote.instance.value().downloadTimeouts.value());
+        }
 
         // bail out now if we are not supposed to obey the server settings
-        if (authority == Authority::Local || !reply.contains("shared"))
+        if (authority == Authority::Local || !remote.shared.has_value())
         {
             spdlog::info("{} authority specified (or empty response), ignoring server parameters",
                          magic_enum::enum_name(authority));
@@ -168,20 +817,22 @@ int models::InstanceConfig::DownloadRelease(curl_progress_callback progressFn, c
             if (shared.productName.has_value())
                 merged.productName = shared.productName.value();
 
-            if (shared.detectionMethod.has_value())
+            // decoded and detected again on next use, but only if it actually changed
+            if (shared.detectionMethod.has_value() && shared.detectionMethod.value() != merged.detectionMethod)
+            {
                 merged.detectionMethod = shared.detectionMethod.value();
+                detectionPlan.reset();
+            }
 
-            if (shared.detection.has_value())
+            if (shared.detection.has_value() && shared.detection.value() != merged.detection)
+            {
                 merged.detection = shared.detection.value();
+                detectionPlan.reset();
+            }
         }
 
         return std::make_tuple(true, "OK");
     }
-    catch (const json::exception& e)
-    {
-        spdlog::error("Failed to parse JSON, error {}", e.what());
-        return std::make_tuple(false, std::format("JSON parsing error: {}", e.what()));
-    }
     catch (const std::exception& e)
     {
         spdlog::error("Unexpected error during response parsing, error {}", e.what());
@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "Common.h"
 #include "InstanceConfig.hpp"
+#include "ConnectionPool.hpp"
+#include "Hashing.hpp"
 
 
 models::InstanceConfig::InstanceConfig(HINSTANCE hInstance, argh::parser& cmdl) : appInstance(hInstance), remote()
@@ -96,12 +98,28 @@ models::InstanceConfig::InstanceConfig(HINSTANCE hInstance, argh::parser& cmdl)
     appPath = util::GetImageBasePathW();
     spdlog::debug("appPath = {}", appPath.string());
 
-    appVersion = util::GetVersionFromFile(appPath);
-    spdlog::debug("appVersion = {}", appVersion.to_string());
+    // read from the loaded image, no need to open our own file again
+    appVersion = util::GetImageVersion().value_or(util::Version{});
+    spdlog::debug("appVersion = {}", appVersion.ToString());
 
     appFilename = appPath.stem().string();
     spdlog::debug("appFilename = {}", appFilename);
 
+    PWSTR localAppData = nullptr;
+    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_DEFAULT, nullptr, &localAppData)))
+    {
+        localDataPath = std::filesystem::path(localAppData) / appFilename;
+    }
+    CoTaskMemFree(localAppData);
+    spdlog::debug("localDataPath = {}", localDataPath.string());
+
+#if defined(NV_FLAGS_PERSIST_NETWORK_CACHE)
+    if (const auto localData = GetLocalDataPath(); !localData.empty())
+    {
+        net::ConnectionPool::Instance().EnablePersistence(localData / "network.cbor");
+    }
+#endif
+
     filenameRegex = NV_FILENAME_REGEX;
     spdlog::debug("filenameRegex = {}", filenameRegex);
 
@@ -125,9 +143,27 @@ models::InstanceConfig::InstanceConfig(HINSTANCE hInstance, argh::parser& cmdl)
             // Override defaults, if specified
             // 
 
-            serverUrlTemplate = data.value("/instance/serverUrlTemplate"_json_pointer, serverUrlTemplate);
+            // either one template or a list of mirrors in order of preference
+            if (const auto& templates = data.value("/instance/serverUrlTemplate"_json_pointer, json{});
+                templates.is_array())
+            {
+                serverUrlTemplate.clear();
+
+                for (const auto& mirror : templates)
+                {
+                    serverUrlTemplate += std::format("{} ", mirror.get<std::string>());
+                }
+
+                serverUrlTemplate = util::trim(serverUrlTemplate);
+            }
+            else if (templates.is_string())
+            {
+                serverUrlTemplate = templates.get<std::string>();
+            }
+
             filenameRegex = data.value("/instance/filenameRegex"_json_pointer, filenameRegex);
             authority = data.value("/instance/authority"_json_pointer, authority);
+            downloadTimeouts = data.value("/instance/downloadTimeouts"_json_pointer, downloadTimeouts);
 
             // populate shared config first either from JSON file or with built-in defaults
             if (data.contains("shared"))
@@ -183,252 +219,370 @@ models::InstanceConfig::InstanceConfig(HINSTANCE hInstance, argh::parser& cmdl)
                         : appFilename;
     spdlog::debug("tenantSubPath = {}", tenantSubPath);
 
-    updateRequestUrl = std::vformat(serverUrlTemplate, std::make_format_args(tenantSubPath));
+    std::stringstream templates(serverUrlTemplate);
+    std::string urlTemplate;
+
+    while (templates >> urlTemplate)
+    {
+        updateRequestUrls.push_back(std::vformat(urlTemplate, std::make_format_args(tenantSubPath)));
+        spdlog::debug("updateRequestUrls[{}] = {}", updateRequestUrls.size() - 1, updateRequestUrls.back());
+    }
+
+    updateRequestUrl = updateRequestUrls.empty() ? std::string{} : updateRequestUrls.front();
     spdlog::debug("updateRequestUrl = {}", updateRequestUrl);
 }
 
 models::InstanceConfig::~InstanceConfig()
 {
+    // a download might still be running in the background
+    CancelReleaseDownload();
+
+    if (summaryTask.has_value())
+    {
+        (*summaryTask).wait();
+    }
+
+    // pooled connections must be closed while curl is still around
+    net::ConnectionPool::Shutdown();
+
     RestClient::disable();
 }
 
-std::tuple<bool, std::string> models::InstanceConfig::IsInstalledVersionOutdated(bool& isOutdated)
+std::filesystem::path models::InstanceConfig::GetLocalDataPath() const
 {
-    const auto& release = GetSelectedRelease();
+    if (localDataPath.empty())
+    {
+        return {};
+    }
+
+    std::error_code ec;
+    create_directories(localDataPath, ec);
 
-    switch (merged.detectionMethod)
+    if (ec)
     {
-    //
-    // Detect product version via registry key and value
-    // 
-    case ProductVersionDetectionMethod::RegistryValue:
-        {
-            spdlog::debug("Running product detection via registry value");
-            const auto& cfg = merged.GetRegistryValueConfig();
-            HKEY hive = nullptr;
+        spdlog::warn("Failed to create {}, error {}", localDataPath.string(), ec.message());
+        return {};
+    }
 
-            switch (cfg.hive)
-            {
-            case RegistryHive::HKCU:
-                hive = HKEY_CURRENT_USER;
-                break;
-            case RegistryHive::HKLM:
-                hive = HKEY_LOCAL_MACHINE;
-                break;
-            case RegistryHive::HKCR:
-                hive = HKEY_CLASSES_ROOT;
-                break;
-            case RegistryHive::Invalid:
-                return std::make_tuple(false, "Invalid hive value");
-            }
+    return localDataPath;
+}
 
-            const auto subKey = ConvertAnsiToWide(cfg.key);
-            const auto valueName = ConvertAnsiToWide(cfg.value);
+void models::InstanceConfig::StartProductDetection()
+{
+    if (detectionTask.has_value())
+    {
+        return;
+    }
 
-            winreg::RegKey key;
+    // the server may still provide it
+    if (merged.detectionMethod == ProductVersionDetectionMethod::Invalid)
+    {
+        spdlog::debug("No local detection configuration, detecting after the server response");
+        return;
+    }
 
-            if (const winreg::RegResult result = key.TryOpen(hive, subKey, KEY_READ); !result)
-            {
-                spdlog::error("Failed to open {}\\{} key", magic_enum::enum_name(cfg.hive), cfg.key);
-                return std::make_tuple(false, "Failed to open registry key for reading");
-            }
+    if (!detectionPlan.has_value())
+    {
+        detectionPlan = DetectionPlan::Compile(merged.detectionMethod, merged.detection);
 
-            const auto& resource = key.TryGetStringValue(valueName);
+        if (!detectionPlan.has_value())
+        {
+            return;
+        }
+    }
 
-            if (!resource.IsValid())
-            {
-                spdlog::error("Failed to access value {}", cfg.value);
-                return std::make_tuple(false, "Failed to read registry value");
-            }
+    spdlog::debug("Starting product detection in the background");
 
-            const std::wstring value = resource.GetValue();
+    // the plan is copied as the server response may replace it meanwhile; hashing waits for the
+    // release version, as it often settles the plan with a registry value or file version alone
+    detectionTask = std::async(std::launch::async, [this, plan = detectionPlan.value()]()
+    {
+        return ProbeInstalledProduct(plan, std::nullopt, {}, false);
+    });
+}
 
-            try
-            {
-                const semver::version localVersion{ConvertWideToANSI(value)};
+std::vector<models::DetectionOutcome> models::InstanceConfig::ProbeInstalledProduct(
+    const DetectionPlan& plan,
+    const std::optional<util::Version>& releaseVersion,
+    std::vector<DetectionOutcome> outcomes,
+    const bool isHashingAllowed
+) const
+{
+    // earlier outcomes may settle the plan now that the release is known
+    if (std::ranges::any_of(outcomes, [&plan, &releaseVersion](const DetectionOutcome& outcome)
+    {
+        return plan.IsConclusive(outcome, releaseVersion);
+    }))
+    {
+        return outcomes;
+    }
 
-                isOutdated = release.GetSemVersion() > localVersion;
-                spdlog::debug("isOutdated = {}", isOutdated);
-            }
-            catch (const std::exception& e)
-            {
-                spdlog::error("Failed to convert value {} into SemVer, error: {}",
-                    ConvertWideToANSI(value), e.what());
-                return std::make_tuple(false, std::format("String to SemVer conversion failed: {}", e.what()));
-            }
+    for (size_t index = outcomes.size(); index < plan.steps.size(); index++)
+    {
+        const auto& step = plan.steps[index];
 
-            return std::make_tuple(true, "OK");
+        if (!isHashingAllowed && DetectionPlan::IsHashing(step.method))
+        {
+            spdlog::debug("Deferring detection via {} until the release is known", magic_enum::enum_name(step.method));
+            break;
         }
-    //
-    // Detect product by comparing version resource
-    // 
-    case ProductVersionDetectionMethod::FileVersion:
+
+        DetectionOutcome outcome{.method = step.method};
+
+        outcome.status = std::visit([this, &outcome](const auto& cfg)
         {
-            spdlog::debug("Running product detection via file version");
-            const auto& cfg = merged.GetFileVersionConfig();
+            return Detect(cfg, outcome);
+        }, step.parameters);
 
-            try
-            {
-                isOutdated = release.GetSemVersion() > util::GetVersionFromFile(cfg.path);
-                spdlog::debug("isOutdated = {}", isOutdated);
-            }
-            catch (...)
-            {
-                spdlog::error("Failed to get version resource from {}", cfg.path);
-                return std::make_tuple(false, "Failed to read file version resource");
-            }
+        outcomes.push_back(std::move(outcome));
 
-            return std::make_tuple(true, "OK");
+        if (plan.IsConclusive(outcomes.back(), releaseVersion))
+        {
+            break;
         }
-    //
-    // Detect product by comparing expected file sizes
-    // 
-    case ProductVersionDetectionMethod::FileSize:
+    }
+
+    return outcomes;
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::IsInstalledVersionOutdated(bool& isOutdated)
+{
+    std::vector<DetectionOutcome> outcomes;
+
+    // always wait for it, it must not run alongside the detection below
+    if (detectionTask.has_value())
+    {
+        auto earlier = detectionTask.value().get();
+        detectionTask.reset();
+
+        // the plan is gone if the server replaced the detection configuration
+        if (detectionPlan.has_value())
         {
-            spdlog::debug("Running product detection via file size");
-            const auto& cfg = merged.GetFileSizeConfig();
+            outcomes = std::move(earlier);
+        }
+    }
 
-            try
-            {
-                const std::filesystem::path file{cfg.path};
+    if (!detectionPlan.has_value())
+    {
+        detectionPlan = DetectionPlan::Compile(merged.detectionMethod, merged.detection);
 
-                isOutdated = file_size(file) != cfg.size;
-                spdlog::debug("isOutdated = {}", isOutdated);
-            }
-            catch (...)
-            {
-                spdlog::error("Failed to get file size from {}", cfg.path);
-                return std::make_tuple(false, "Failed to read file size");
-            }
+        if (!detectionPlan.has_value())
+        {
+            return std::make_tuple(false, "Invalid detection configuration");
+        }
+    }
+
+    const auto& plan = detectionPlan.value();
+    const auto releaseVersion = GetSelectedRelease().parsedVersion;
 
-            return std::make_tuple(true, "OK");
+    // resumes after the steps the background detection got through
+    outcomes = ProbeInstalledProduct(plan, releaseVersion, std::move(outcomes), true);
+
+    manifestMismatches.clear();
+    std::tuple<bool, std::string> lastError = std::make_tuple(false, "No detection method matched");
+    std::vector<DetectionVerdict> verdicts;
+
+    for (auto& outcome : outcomes)
+    {
+        verdicts.push_back(outcome.GetVerdict(releaseVersion));
+
+        if (!outcome.IsSuccess())
+        {
+            spdlog::warn("Detection via {} failed, error {}", magic_enum::enum_name(outcome.method),
+                         std::get<1>(outcome.status));
+            lastError = outcome.status;
+            continue;
         }
-    //
-    // Detect product by hashing a given file checksum
-    // 
-    case ProductVersionDetectionMethod::FileChecksum:
+
+        if (outcome.method == ProductVersionDetectionMethod::FileManifest)
         {
-            spdlog::debug("Running product detection via file checksum");
-            const auto& cfg = merged.GetFileChecksumConfig();
+            manifestMismatches = std::move(outcome.mismatches);
+        }
+    }
 
-            if (!std::filesystem::exists(cfg.path))
-            {
-                spdlog::error("File {} doesn't exist", cfg.path);
-                return std::make_tuple(false, "File to hash not found");
-            }
+    // steps the background detection ran past one that is conclusive now are ignored
+    const auto result = CombineVerdicts(plan.mode, verdicts);
 
-            std::ifstream file(cfg.path, std::ios::binary);
+    if (!result.has_value())
+    {
+        spdlog::error("No detection rule could be evaluated");
+        return lastError;
+    }
 
-            if (!file.is_open())
-            {
-                spdlog::error("Failed to open file {}", cfg.path);
-                return std::make_tuple(false, "Failed to open file");
-            }
+    isOutdated = result.value();
+    spdlog::debug("isOutdated = {}", isOutdated);
 
-            constexpr std::size_t chunkSize = 4 * 1024; // 4 KB
+    return std::make_tuple(true, "OK");
+}
 
-            switch (cfg.algorithm)
-            {
-            case ChecksumAlgorithm::MD5:
-                {
-                    spdlog::debug("Hashing with MD5");
-                    MD5 alg;
-
-                    std::vector<char> buffer(chunkSize);
-                    while (!file.eof())
-                    {
-                        file.read(buffer.data(), buffer.size());
-                        std::streamsize bytesRead = file.gcount();
-
-                        alg.add(buffer.data(), bytesRead);
-
-                        if (bytesRead < chunkSize && !file.eof())
-                        {
-                            if (file.fail())
-                            {
-                                spdlog::error("Failed to read file {} to end", cfg.path);
-                                return std::make_tuple(false, "Failed to read file");
-                            }
-                        }
-                    }
-
-                    isOutdated = !util::icompare(alg.getHash(), cfg.hash);
-                    spdlog::debug("isOutdated = {}", isOutdated);
-
-                    return std::make_tuple(true, "OK");
-                }
-            case ChecksumAlgorithm::SHA1:
-                {
-                    spdlog::debug("Hashing with SHA1");
-                    SHA1 alg;
-
-                    std::vector<char> buffer(chunkSize);
-                    while (!file.eof())
-                    {
-                        file.read(buffer.data(), buffer.size());
-                        std::streamsize bytesRead = file.gcount();
-
-                        alg.add(buffer.data(), bytesRead);
-
-                        if (bytesRead < chunkSize && !file.eof())
-                        {
-                            if (file.fail())
-                            {
-                                spdlog::error("Failed to read file {} to end", cfg.path);
-                                return std::make_tuple(false, "Failed to read file");
-                            }
-                        }
-                    }
-
-                    isOutdated = !util::icompare(alg.getHash(), cfg.hash);
-                    spdlog::debug("isOutdated = {}", isOutdated);
-
-                    return std::make_tuple(true, "OK");
-                }
-            case ChecksumAlgorithm::SHA256:
-                {
-                    spdlog::debug("Hashing with SHA256");
-                    SHA256 alg;
-
-                    std::vector<char> buffer(chunkSize);
-                    while (!file.eof())
-                    {
-                        file.read(buffer.data(), buffer.size());
-                        std::streamsize bytesRead = file.gcount();
-
-                        alg.add(buffer.data(), bytesRead);
-
-                        if (bytesRead < chunkSize && !file.eof())
-                        {
-                            if (file.fail())
-                            {
-                                spdlog::error("Failed to read file {} to end", cfg.path);
-                                return std::make_tuple(false, "Failed to read file");
-                            }
-                        }
-                    }
-
-                    isOutdated = !util::icompare(alg.getHash(), cfg.hash);
-                    spdlog::debug("isOutdated = {}", isOutdated);
-
-                    return std::make_tuple(true, "OK");
-                }
-            case ChecksumAlgorithm::Invalid:
-                spdlog::error("Invalid hashing algorithm specified");
-                return std::make_tuple(false, "Invalid hashing algorithm");
-            }
+std::tuple<bool, std::string> models::InstanceConfig::Detect(const RegistryValueConfig& cfg, DetectionOutcome& outcome) const
+{
+    spdlog::debug("Running product detection via registry value");
+    HKEY hive = nullptr;
 
-            file.close();
+    switch (cfg.hive)
+    {
+    case RegistryHive::HKCU:
+        hive = HKEY_CURRENT_USER;
+        break;
+    case RegistryHive::HKLM:
+        hive = HKEY_LOCAL_MACHINE;
+        break;
+    case RegistryHive::HKCR:
+        hive = HKEY_CLASSES_ROOT;
+        break;
+    case RegistryHive::Invalid:
+        return std::make_tuple(false, "Invalid hive value");
+    }
 
-            break;
-        }
-    case ProductVersionDetectionMethod::Invalid:
-        spdlog::error("Invalid detection method specified");
-        return std::make_tuple(false, "Invalid detection method");
+    const auto subKey = ConvertAnsiToWide(cfg.key);
+    const auto valueName = ConvertAnsiToWide(cfg.value);
+
+    winreg::RegKey key;
+
+    if (const winreg::RegResult result = key.TryOpen(hive, subKey, KEY_READ); !result)
+    {
+        spdlog::error("Failed to open {}\\{} key", magic_enum::enum_name(cfg.hive), cfg.key);
+        return std::make_tuple(false, "Failed to open registry key for reading");
     }
 
-    spdlog::error("No detection method matched");
-    return std::make_tuple(false, "Unsupported detection method");
+    const auto& resource = key.TryGetStringValue(valueName);
+
+    if (!resource.IsValid())
+    {
+        spdlog::error("Failed to access value {}", cfg.value);
+        return std::make_tuple(false, "Failed to read registry value");
+    }
+
+    const std::string value = ConvertWideToANSI(resource.GetValue());
+    const auto localVersion = util::Version::Parse(value);
+
+    if (!localVersion.has_value())
+    {
+        spdlog::error("Failed to convert value {} into a version", value);
+        return std::make_tuple(false, std::format("String to version conversion failed: {}", value));
+    }
+
+    outcome.installedVersion = localVersion.value();
+    spdlog::debug("installedVersion = {}", localVersion.value().ToString());
+
+    return std::make_tuple(true, "OK");
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::Detect(const FileVersionConfig& cfg, DetectionOutcome& outcome) const
+{
+    spdlog::debug("Running product detection via file version");
+
+    const auto localVersion = util::GetVersionFromFile(cfg.path);
+
+    if (!localVersion.has_value())
+    {
+        spdlog::error("Failed to get version resource from {}", cfg.path);
+        return std::make_tuple(false, "Failed to read file version resource");
+    }
+
+    outcome.installedVersion = localVersion.value();
+    spdlog::debug("installedVersion = {}", localVersion.value().ToString());
+
+    return std::make_tuple(true, "OK");
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::Detect(const FileSizeConfig& cfg, DetectionOutcome& outcome) const
+{
+    spdlog::debug("Running product detection via file size");
+
+    try
+    {
+        const std::filesystem::path file{cfg.path};
+
+        outcome.isOutdated = file_size(file) != cfg.size;
+        spdlog::debug("isOutdated = {}", outcome.isOutdated);
+    }
+    catch (...)
+    {
+        spdlog::error("Failed to get file size from {}", cfg.path);
+        return std::make_tuple(false, "Failed to read file size");
+    }
+
+    return std::make_tuple(true, "OK");
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::Detect(const FileChecksumConfig& cfg, DetectionOutcome& outcome) const
+{
+    spdlog::debug("Running product detection via file checksum");
+
+    if (!std::filesystem::exists(cfg.path))
+    {
+        spdlog::error("File {} doesn't exist", cfg.path);
+        return std::make_tuple(false, "File to hash not found");
+    }
+
+    std::vector<uint8_t> expected;
+
+    if (!hashing::ParseHexDigest(util::trim(cfg.hash), expected))
+    {
+        spdlog::error("Expected checksum {} is not a valid hex string", cfg.hash);
+        return std::make_tuple(false, "Invalid checksum");
+    }
+
+    spdlog::debug("Hashing with {}", magic_enum::enum_name(cfg.algorithm));
+
+#if defined(NV_FLAGS_NO_HASH_CACHE)
+    const auto digest = hashing::HashFile(cfg.algorithm, cfg.path);
+#else
+    const auto localData = GetLocalDataPath();
+    const auto cacheFile = localData.empty() ? std::filesystem::path{} : localData / "hashes.cbor";
+    auto cache = hashing::LoadHashCache(cacheFile);
+
+    const auto digest = hashing::HashFile(cfg.algorithm, cfg.path, cache);
+
+    hashing::SaveHashCache(cacheFile, cache);
+#endif
+
+    if (!digest.has_value())
+    {
+        spdlog::error("Failed to hash file {}", cfg.path);
+        return std::make_tuple(false, "Failed to hash file");
+    }
+
+    outcome.isOutdated = digest.value() != expected;
+    spdlog::debug("isOutdated = {}", outcome.isOutdated);
+
+    return std::make_tuple(true, "OK");
+}
+
+std::tuple<bool, std::string> models::InstanceConfig::Detect(const FileManifestConfig& cfg, DetectionOutcome& outcome) const
+{
+    spdlog::debug("Running product detection via file manifest");
+
+#if defined(NV_FLAGS_NO_HASH_CACHE)
+    const auto mismatches = hashing::VerifyManifest(cfg, nullptr, NV_MANIFEST_MAX_THREADS);
+#else
+    const auto localData = GetLocalDataPath();
+    const auto cacheFile = localData.empty() ? std::filesystem::path{} : localData / "hashes.cbor";
+    auto cache = hashing::LoadHashCache(cacheFile);
+
+    const auto mismatches = hashing::VerifyManifest(cfg, &cache, NV_MANIFEST_MAX_THREADS);
+
+    hashing::SaveHashCache(cacheFile, cache);
+#endif
+
+    if (!mismatches.has_value())
+    {
+        spdlog::error("Invalid file manifest for {}", cfg.root);
+        return std::make_tuple(false, "Invalid file manifest");
+    }
+
+    for (const auto& mismatch : mismatches.value())
+    {
+        spdlog::info("File {} differs ({})", mismatch.path, magic_enum::enum_name(mismatch.reason));
+    }
+
+    outcome.mismatches = mismatches.value();
+    outcome.isOutdated = !outcome.mismatches.empty();
+    spdlog::debug("isOutdated = {}", outcome.isOutdated);
+
+    return std::make_tuple(true, "OK");
 }
 
 std::tuple<bool, std::string> models::InstanceConfig::RegisterAutostart(const std::string& launchArgs) const
@@ -0,0 +1,331 @@
+#pragma once
+
+// free of Windows headers so it builds on any platform
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+
+
+namespace util::pe
+{
+    /**
+     * \brief How the image is laid out in memory.
+     */
+    enum class Layout
+    {
+        /** The raw file content, e.g. a mapped view of the file */
+        File,
+        /** Sections at their relative virtual addresses, as placed by the loader */
+        Image
+    };
+
+    /**
+     * \brief The version numbers of a VS_FIXEDFILEINFO, most significant component first.
+     */
+    struct FixedVersion
+    {
+        std::array<uint16_t, 4> fileVersion{};
+        std::array<uint16_t, 4> productVersion{};
+    };
+
+    namespace detail
+    {
+        constexpr uint16_t DosSignature = 0x5A4D;
+        constexpr uint32_t NtSignature = 0x00004550;
+        constexpr uint16_t Pe32Magic = 0x10B;
+        constexpr uint16_t Pe32PlusMagic = 0x20B;
+        constexpr uint32_t ResourceDirectoryIndex = 2;
+        /** RT_VERSION */
+        constexpr uint32_t VersionResourceType = 16;
+        constexpr uint32_t SubdirectoryFlag = 0x80000000;
+        constexpr uint32_t FixedFileInfoSignature = 0xFEEF04BD;
+        /** The loader refuses images with more sections */
+        constexpr uint16_t MaxSections = 96;
+
+        constexpr uint64_t FileHeaderSize = 20;
+        constexpr uint64_t SectionHeaderSize = 40;
+        constexpr uint64_t DataDirectorySize = 8;
+        constexpr uint64_t ResourceDirectorySize = 16;
+        constexpr uint64_t ResourceEntrySize = 8;
+        constexpr uint64_t FixedFileInfoSize = 52;
+
+        /**
+         * \brief Bounds-checked reads of little-endian values.
+         */
+        class Reader
+        {
+            std::span<const uint8_t> image;
+
+        public:
+            explicit Reader(const std::span<const uint8_t> image) : image(image)
+            {
+            }
+
+            template <typename T>
+            [[nodiscard]] std::optional<T> Read(const uint64_t offset) const
+            {
+                if (offset > image.size() || image.size() - offset < sizeof(T))
+                {
+                    return std::nullopt;
+                }
+
+                T value;
+                std::memcpy(&value, image.data() + offset, sizeof(T));
+
+                return value;
+            }
+        };
+
+        constexpr std::array<uint16_t, 4> Split(const uint32_t ms, const uint32_t ls)
+        {
+            return {
+                static_cast<uint16_t>(ms >> 16), static_cast<uint16_t>(ms & 0xFFFF),
+                static_cast<uint16_t>(ls >> 16), static_cast<uint16_t>(ls & 0xFFFF)
+            };
+        }
+    }
+
+    /**
+     * \brief Reads the fixed part of the version resource of a PE image.
+     * \remarks Only the headers, the resource directory and the version block are read, so on a mapped
+     *          view just the few pages holding them are ever faulted in. Every offset is validated,
+     *          damaged or hostile files simply yield no version.
+     * \param image The whole file or loaded image.
+     * \param layout Whether the image is a file or has been placed by the loader.
+     * \return The version numbers or empty if the image has no valid version resource.
+     */
+    inline std::optional<FixedVersion> ReadFixedVersion(const std::span<const uint8_t> image,
+                                                        const Layout layout = Layout::File)
+    {
+        using namespace detail;
+
+        const Reader reader(image);
+
+        if (reader.Read<uint16_t>(0) != DosSignature)
+        {
+            return std::nullopt;
+        }
+
+        const auto ntHeaders = reader.Read<uint32_t>(0x3C);
+
+        if (!ntHeaders.has_value() || reader.Read<uint32_t>(ntHeaders.value()) != NtSignature)
+        {
+            return std::nullopt;
+        }
+
+        const uint64_t fileHeader = uint64_t{ntHeaders.value()} + 4;
+        const auto sectionCount = reader.Read<uint16_t>(fileHeader + 2);
+        const auto optionalHeaderSize = reader.Read<uint16_t>(fileHeader + 16);
+
+        if (!sectionCount.has_value() || !optionalHeaderSize.has_value() || sectionCount.value() > MaxSections)
+        {
+            return std::nullopt;
+        }
+
+        const uint64_t optionalHeader = fileHeader + FileHeaderSize;
+        const auto magic = reader.Read<uint16_t>(optionalHeader);
+        uint64_t dataDirectories = 0;
+
+        if (magic == Pe32Magic)
+        {
+            dataDirectories = optionalHeader + 96;
+        }
+        else if (magic == Pe32PlusMagic)
+        {
+            dataDirectories = optionalHeader + 112;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+
+        const auto directoryCount = reader.Read<uint32_t>(dataDirectories - 4);
+        const uint64_t resourceDirectory = dataDirectories + ResourceDirectoryIndex * DataDirectorySize;
+
+        if (!directoryCount.has_value() || directoryCount.value() <= ResourceDirectoryIndex ||
+            resourceDirectory + DataDirectorySize > optionalHeader + optionalHeaderSize.value())
+        {
+            return std::nullopt;
+        }
+
+        const auto resourceRva = reader.Read<uint32_t>(resourceDirectory);
+
+        if (!resourceRva.has_value() || resourceRva.value() == 0)
+        {
+            return std::nullopt;
+        }
+
+        const uint64_t sectionHeaders = optionalHeader + optionalHeaderSize.value();
+
+        // loaded images are addressed by RVA, files need the section the RVA falls into
+        const auto toOffset = [&](const uint32_t rva) -> std::optional<uint64_t>
+        {
+            if (layout == Layout::Image)
+            {
+                return rva;
+            }
+
+            for (uint16_t index = 0; index < sectionCount.value(); index++)
+            {
+                const uint64_t section = sectionHeaders + index * SectionHeaderSize;
+                const auto virtualSize = reader.Read<uint32_t>(section + 8);
+                const auto virtualAddress = reader.Read<uint32_t>(section + 12);
+                const auto rawSize = reader.Read<uint32_t>(section + 16);
+                const auto rawOffset = reader.Read<uint32_t>(section + 20);
+
+                if (!virtualSize.has_value() || !virtualAddress.has_value() ||
+                    !rawSize.has_value() || !rawOffset.has_value())
+                {
+                    return std::nullopt;
+                }
+
+                if (rva < virtualAddress.value() ||
+                    rva - virtualAddress.value() >= std::max(virtualSize.value(), rawSize.value()))
+                {
+                    continue;
+                }
+
+                const uint32_t delta = rva - virtualAddress.value();
+
+                // zero-filled tail of the section, not present in the file
+                if (delta >= rawSize.value())
+                {
+                    return std::nullopt;
+                }
+
+                return uint64_t{rawOffset.value()} + delta;
+            }
+
+            return std::nullopt;
+        };
+
+        const auto resources = toOffset(resourceRva.value());
+
+        if (!resources.has_value())
+        {
+            return std::nullopt;
+        }
+
+        // gets the target of the entry with the given ID or of the first entry, relative to the resources
+        const auto findEntry = [&](const uint32_t directory, const std::optional<uint32_t> id) -> std::optional<uint32_t>
+        {
+            const uint64_t base = resources.value() + directory;
+            const auto namedCount = reader.Read<uint16_t>(base + 12);
+            const auto idCount = reader.Read<uint16_t>(base + 14);
+
+            if (!namedCount.has_value() || !idCount.has_value())
+            {
+                return std::nullopt;
+            }
+
+            // entries identified by ID follow those identified by name
+            const uint32_t first = id.has_value() ? namedCount.value() : 0;
+            const uint32_t count = uint32_t{namedCount.value()} + idCount.value();
+
+            for (uint32_t index = first; index < count; index++)
+            {
+                const uint64_t entry = base + ResourceDirectorySize + index * ResourceEntrySize;
+                const auto name = reader.Read<uint32_t>(entry);
+                const auto target = reader.Read<uint32_t>(entry + 4);
+
+                if (!name.has_value() || !target.has_value())
+                {
+                    return std::nullopt;
+                }
+
+                if (!id.has_value() || name.value() == id.value())
+                {
+                    return target;
+                }
+            }
+
+            return std::nullopt;
+        };
+
+        // resources are a tree of type, name and language, the version resource is usually ID 1 in one language
+        const auto names = findEntry(0, VersionResourceType);
+
+        if (!names.has_value() || (names.value() & SubdirectoryFlag) == 0)
+        {
+            return std::nullopt;
+        }
+
+        const auto languages = findEntry(names.value() & ~SubdirectoryFlag, std::nullopt);
+
+        if (!languages.has_value() || (languages.value() & SubdirectoryFlag) == 0)
+        {
+            return std::nullopt;
+        }
+
+        const auto dataEntry = findEntry(languages.value() & ~SubdirectoryFlag, std::nullopt);
+
+        if (!dataEntry.has_value() || (dataEntry.value() & SubdirectoryFlag) != 0)
+        {
+            return std::nullopt;
+        }
+
+        const auto dataRva = reader.Read<uint32_t>(resources.value() + dataEntry.value());
+        const auto dataSize = reader.Read<uint32_t>(resources.value() + dataEntry.value() + 4);
+
+        if (!dataRva.has_value() || !dataSize.has_value())
+        {
+            return std::nullopt;
+        }
+
+        const auto versionInfo = toOffset(dataRva.value());
+
+        if (!versionInfo.has_value())
+        {
+            return std::nullopt;
+        }
+
+        // VS_VERSIONINFO: wLength, wValueLength, wType, the key, padding to 32 bits, VS_FIXEDFILEINFO
+        constexpr std::u16string_view key = u"VS_VERSION_INFO";
+        constexpr uint64_t keyOffset = 6;
+        constexpr uint64_t valueOffset = (keyOffset + (key.size() + 1) * 2 + 3) & ~uint64_t{3};
+
+        const auto valueLength = reader.Read<uint16_t>(versionInfo.value() + 2);
+
+        if (!valueLength.has_value() || valueLength.value() < FixedFileInfoSize ||
+            dataSize.value() < valueOffset + FixedFileInfoSize)
+        {
+            return std::nullopt;
+        }
+
+        for (size_t index = 0; index <= key.size(); index++)
+        {
+            const uint16_t expected = index < key.size() ? static_cast<uint16_t>(key[index]) : 0;
+
+            if (reader.Read<uint16_t>(versionInfo.value() + keyOffset + index * 2) != expected)
+            {
+                return std::nullopt;
+            }
+        }
+
+        const uint64_t fixedInfo = versionInfo.value() + valueOffset;
+
+        if (reader.Read<uint32_t>(fixedInfo) != FixedFileInfoSignature)
+        {
+            return std::nullopt;
+        }
+
+        const auto fileMs = reader.Read<uint32_t>(fixedInfo + 8);
+        const auto fileLs = reader.Read<uint32_t>(fixedInfo + 12);
+        const auto productMs = reader.Read<uint32_t>(fixedInfo + 16);
+        const auto productLs = reader.Read<uint32_t>(fixedInfo + 20);
+
+        if (!fileMs.has_value() || !fileLs.has_value() || !productMs.has_value() || !productLs.has_value())
+        {
+            return std::nullopt;
+        }
+
+        return FixedVersion{
+            .fileVersion = Split(fileMs.value(), fileLs.value()),
+            .productVersion = Split(productMs.value(), productLs.value())
+        };
+    }
+}
@@ -0,0 +1,244 @@
+#include "pch.h"
+#include "Common.h"
+#include "UpdateResponse.hpp"
+
+
+void models::ReleaseIndex::Add(json&& record)
+{
+    if (!record.is_object())
+    {
+        return;
+    }
+
+    util::Version version;
+
+    if (const auto value = record.find("version"); value != record.end() && value->is_string())
+    {
+        const auto& text = value->get_ref<const std::string&>();
+        const auto parsed = util::Version::Parse(text);
+
+        if (!parsed.has_value())
+        {
+            spdlog::warn("Release has invalid version {}", text);
+        }
+
+        version = parsed.value_or(util::Version{});
+    }
+
+    const auto isDisabled = record.find("disabled");
+    const auto channel = record.find("channel");
+    uint16_t channelId = 0;
+
+    if (channel != record.end() && channel->is_string())
+    {
+        const auto& name = channel->get_ref<const std::string&>();
+        const auto known = std::ranges::find(channelNames, name);
+
+        channelId = static_cast<uint16_t>(std::distance(channelNames.begin(), known));
+
+        if (known == channelNames.end())
+        {
+            channelNames.push_back(name);
+        }
+    }
+
+    const auto offset = records.size();
+    json::to_cbor(record, records);
+
+    if (records.size() > UINT32_MAX)
+    {
+        throw std::length_error("Release records exceed 4 GB");
+    }
+
+    versions.push_back(version);
+    disabled.push_back(isDisabled != record.end() && isDisabled->is_boolean() && isDisabled->get<bool>());
+    channels.push_back(channelId);
+    offsets.push_back(static_cast<uint32_t>(offset));
+    lengths.push_back(static_cast<uint32_t>(records.size() - offset));
+}
+
+void models::ReleaseIndex::Reserve(const size_t count)
+{
+    versions.reserve(count);
+    disabled.reserve(count);
+    channels.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+}
+
+void models::ReleaseIndex::Sort()
+{
+    std::vector<uint32_t> order(versions.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    // top release is always latest by version, even if the response wasn't the right order
+    std::ranges::stable_sort(order, [this](const uint32_t lhs, const uint32_t rhs)
+    {
+        return versions[lhs] > versions[rhs];
+    });
+
+    auto permute = [&order](auto& column)
+    {
+        std::remove_reference_t<decltype(column)> sorted;
+        sorted.reserve(column.size());
+
+        for (const auto row : order)
+        {
+            sorted.push_back(column[row]);
+        }
+
+        column = std::move(sorted);
+    };
+
+    permute(versions);
+    permute(disabled);
+    permute(channels);
+    permute(offsets);
+    permute(lengths);
+
+    enabledRows.clear();
+
+    for (uint32_t row = 0; row < disabled.size(); row++)
+    {
+        if (disabled[row] == 0)
+        {
+            enabledRows.push_back(row);
+        }
+    }
+}
+
+void models::ReleaseIndex::Clear()
+{
+    *this = ReleaseIndex{};
+}
+
+std::optional<size_t> models::ReleaseIndex::FindLatestEnabled(const std::string_view channel) const
+{
+    for (const auto row : enabledRows)
+    {
+        if (channel.empty() || channelNames[channels[row]] == channel)
+        {
+            return row;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::span<const uint32_t> models::ReleaseIndex::GetEnabledNewerThan(const util::Version& version) const
+{
+    const auto end = std::ranges::partition_point(enabledRows, [this, &version](const uint32_t row)
+    {
+        return versions[row] > version;
+    });
+
+    return {enabledRows.begin(), end};
+}
+
+models::UpdateRelease models::ReleaseIndex::Materialize(const size_t row) const
+{
+    const auto begin = records.begin() + offsets[row];
+
+    auto release = json::from_cbor(begin, begin + lengths[row]).get<UpdateRelease>();
+    release.parsedVersion = versions[row];
+
+    return release;
+}
+
+json models::ReleaseIndex::ToSnapshot() const
+{
+    std::vector<uint64_t> keys;
+    keys.reserve(versions.size() * 2);
+
+    for (const auto& version : versions)
+    {
+        keys.push_back(version.KeyHigh());
+        keys.push_back(version.KeyLow());
+    }
+
+    return {
+        {"versions", keys},
+        {"disabled", disabled},
+        {"channels", channels},
+        {"offsets", offsets},
+        {"lengths", lengths},
+        {"records", json::binary(records)},
+        {"channelNames", channelNames}
+    };
+}
+
+bool models::ReleaseIndex::FromSnapshot(const json& snapshot)
+{
+    Clear();
+
+    try
+    {
+        const auto keys = snapshot.at("versions").get<std::vector<uint64_t>>();
+
+        disabled = snapshot.at("disabled").get<std::vector<uint8_t>>();
+        channels = snapshot.at("channels").get<std::vector<uint16_t>>();
+        offsets = snapshot.at("offsets").get<std::vector<uint32_t>>();
+        lengths = snapshot.at("lengths").get<std::vector<uint32_t>>();
+        records = snapshot.at("records").get_binary();
+        channelNames = snapshot.at("channelNames").get<std::vector<std::string>>();
+
+        const size_t rows = keys.size() / 2;
+
+        // every lookup indexes the columns without checking, so they have to line up
+        const bool isValid = keys.size() % 2 == 0 && disabled.size() == rows && channels.size() == rows &&
+            offsets.size() == rows && lengths.size() == rows && !channelNames.empty() &&
+            std::ranges::all_of(channels, [this](const uint16_t channel) { return channel < channelNames.size(); });
+
+        if (!isValid)
+        {
+            Clear();
+            return false;
+        }
+
+        for (size_t row = 0; row < rows; row++)
+        {
+            if (static_cast<uint64_t>(offsets[row]) + lengths[row] > records.size())
+            {
+                Clear();
+                return false;
+            }
+
+            versions.push_back(util::Version::FromKey(keys[row * 2], keys[row * 2 + 1]));
+
+            if (disabled[row] == 0)
+            {
+                enabledRows.push_back(static_cast<uint32_t>(row));
+            }
+        }
+    }
+    catch (const json::exception&)
+    {
+        Clear();
+        return false;
+    }
+
+    return true;
+}
+
+void models::to_json(json& j, const ReleaseIndex& index)
+{
+    j = json::array();
+
+    for (size_t row = 0; row < index.Size(); row++)
+    {
+        j.push_back(index.Materialize(row));
+    }
+}
+
+void models::from_json(const json& j, ReleaseIndex& index)
+{
+    index.Clear();
+    index.Reserve(j.size());
+
+    for (const auto& record : j)
+    {
+        index.Add(json(record));
+    }
+
+    index.Sort();
+}
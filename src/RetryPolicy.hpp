@@ -0,0 +1,257 @@
+#pragma once
+#include <curl/curl.h>
+
+// shared with the self-updater, which doesn't use the precompiled header
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+
+namespace net
+{
+    /**
+     * \brief Decides whether and when a failed request gets another attempt.
+     * \remarks Results are HTTP status codes or CURLcodes on transport errors, as returned by the
+     *          transfer functions, negative values are local failures. Delays grow exponentially with
+     *          decorrelated jitter so many clients hitting the same outage don't retry in lockstep.
+     *          Header-only so the self-updater can use it as well.
+     */
+    class RetryPolicy
+    {
+        int maxAttempts;
+        std::chrono::milliseconds baseDelay;
+        std::chrono::milliseconds maxDelay;
+        /** Server requested delays longer than this are not waited for */
+        std::chrono::seconds maxRetryAfter;
+
+        int attempt{1};
+        std::chrono::milliseconds previousDelay;
+        std::mt19937 generator{std::random_device{}()};
+
+        static constexpr char ToLower(const char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c; }
+
+        static constexpr std::string_view Trim(std::string_view value)
+        {
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+                value.remove_prefix(1);
+
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t' ||
+                value.back() == '\r' || value.back() == '\n'))
+                value.remove_suffix(1);
+
+            return value;
+        }
+
+    public:
+        /**
+         * \param maxAttempts Total number of attempts including the first one.
+         * \param baseDelay The minimum delay between two attempts.
+         * \param maxDelay The maximum delay between two attempts.
+         * \param maxRetryAfter Give up if the server asks to come back later than this.
+         */
+        RetryPolicy(const int maxAttempts, const std::chrono::milliseconds baseDelay,
+                    const std::chrono::milliseconds maxDelay,
+                    const std::chrono::seconds maxRetryAfter = std::chrono::minutes(2))
+            : maxAttempts(maxAttempts), baseDelay(baseDelay), maxDelay(std::max(maxDelay, baseDelay)),
+              maxRetryAfter(maxRetryAfter), previousDelay(baseDelay)
+        {
+        }
+
+        /**
+         * \brief Checks if a result is worth another attempt.
+         * \param code The HTTP status code or CURLcode.
+         * \return True for timeouts, dropped connections, rate limiting and server errors.
+         */
+        static constexpr bool IsRetryable(const int code)
+        {
+            // local failures like I/O errors won't go away by asking again
+            if (code < 0)
+            {
+                return false;
+            }
+
+            if (code < 100)
+            {
+                switch (static_cast<CURLcode>(code))
+                {
+                case CURLE_COULDNT_RESOLVE_PROXY:
+                case CURLE_COULDNT_RESOLVE_HOST:
+                case CURLE_COULDNT_CONNECT:
+                case CURLE_PARTIAL_FILE:
+                case CURLE_OPERATION_TIMEDOUT:
+                case CURLE_SSL_CONNECT_ERROR:
+                case CURLE_GOT_NOTHING:
+                case CURLE_SEND_ERROR:
+                case CURLE_RECV_ERROR:
+                case CURLE_HTTP2:
+                case CURLE_HTTP2_STREAM:
+                    return true;
+                default:
+                    // invalid URLs, certificate problems, aborts by the user etc.
+                    return false;
+                }
+            }
+
+            switch (code)
+            {
+            case 408: // Request Timeout
+            case 425: // Too Early
+            case 429: // Too Many Requests
+            case 500: // Internal Server Error
+            case 502: // Bad Gateway
+            case 503: // Service Unavailable
+            case 504: // Gateway Timeout
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * \brief Parses the value of a Retry-After header.
+         * \param value Either a number of seconds or an HTTP date.
+         * \return The delay or empty if the value is invalid.
+         */
+        static std::optional<std::chrono::seconds> ParseRetryAfter(std::string_view value)
+        {
+            value = Trim(value);
+
+            if (value.empty())
+            {
+                return std::nullopt;
+            }
+
+            if (std::ranges::all_of(value, [](const char c) { return c >= '0' && c <= '9'; }))
+            {
+                // anything this long is too far in the future to wait for anyway
+                if (value.size() > 9)
+                {
+                    return std::chrono::seconds(INT32_MAX);
+                }
+
+                int64_t seconds = 0;
+
+                for (const char c : value)
+                {
+                    seconds = seconds * 10 + (c - '0');
+                }
+
+                return std::chrono::seconds(seconds);
+            }
+
+            const std::string date(value);
+            const time_t when = curl_getdate(date.c_str(), nullptr);
+
+            if (when < 0)
+            {
+                return std::nullopt;
+            }
+
+            return std::chrono::seconds(std::max<int64_t>(when - std::time(nullptr), 0));
+        }
+
+        /**
+         * \brief Extracts the delay from a raw header line as received by a curl header callback.
+         * \return The delay or empty if the line is not a valid Retry-After header.
+         */
+        static std::optional<std::chrono::seconds> ParseRetryAfterLine(const std::string_view line)
+        {
+            constexpr std::string_view name = "retry-after:";
+
+            if (line.size() < name.size() ||
+                !std::ranges::equal(line.substr(0, name.size()), name,
+                                    [](const char a, const char b) { return ToLower(a) == b; }))
+            {
+                return std::nullopt;
+            }
+
+            return ParseRetryAfter(line.substr(name.size()));
+        }
+
+        /**
+         * \brief The number of the attempt about to be made or just made, starting at 1.
+         */
+        [[nodiscard]] int GetAttempt() const { return attempt; }
+
+        /**
+         * \brief Calculates the delay before the next attempt.
+         * \param code The result of the failed attempt.
+         * \param retryAfter The delay requested by the server, if any.
+         * \return The delay or empty if the request should not be repeated.
+         */
+        std::optional<std::chrono::milliseconds> NextDelay(const int code,
+                                                           const std::optional<std::chrono::seconds> retryAfter = {})
+        {
+            if (attempt >= maxAttempts || !IsRetryable(code))
+            {
+                return std::nullopt;
+            }
+
+            if (retryAfter.has_value() && retryAfter.value() > maxRetryAfter)
+            {
+                return std::nullopt;
+            }
+
+            // decorrelated jitter: anywhere between the base and three times the previous delay
+            std::uniform_int_distribution<int64_t> distribution(
+                baseDelay.count(),
+                std::max(baseDelay.count(), previousDelay.count() * 3)
+            );
+
+            auto delay = std::min(std::chrono::milliseconds(distribution(generator)), maxDelay);
+            previousDelay = delay;
+
+            // the server knows best, but never hammer it earlier than our own schedule
+            if (retryAfter.has_value())
+            {
+                delay = std::max<std::chrono::milliseconds>(delay, retryAfter.value());
+            }
+
+            attempt++;
+
+            return delay;
+        }
+
+        /**
+         * \brief Blocks until the next attempt is due.
+         * \param code The result of the failed attempt.
+         * \param retryAfter The delay requested by the server, if any.
+         * \param isCancelled Optionally aborts waiting when set.
+         * \return True if another attempt should be made, false to give up.
+         */
+        bool Wait(const int code, const std::optional<std::chrono::seconds> retryAfter = {},
+                  const std::atomic<bool>* isCancelled = nullptr)
+        {
+            const auto delay = NextDelay(code, retryAfter);
+
+            if (!delay.has_value())
+            {
+                return false;
+            }
+
+            spdlog::warn("Attempt {} of {} failed with {}, retrying in {} ms",
+                         attempt - 1, maxAttempts, code, delay.value().count());
+
+            const auto deadline = std::chrono::steady_clock::now() + delay.value();
+
+            while (std::chrono::steady_clock::now() < deadline)
+            {
+                if (isCancelled != nullptr && isCancelled->load())
+                {
+                    return false;
+                }
+
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    deadline - std::chrono::steady_clock::now(), std::chrono::milliseconds(100)));
+            }
+
+            return true;
+        }
+    };
+}
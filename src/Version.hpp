@@ -0,0 +1,235 @@
+#pragma once
+
+namespace util
+{
+    /**
+     * \brief A product version of up to four numeric components plus an optional pre-release tag.
+     * \remarks Accepts SemVer ("1.2.3-rc.1+meta") as well as Windows file versions ("7.0.12.1").
+     *          Parsing neither allocates nor throws, comparing uses a packed 128-bit key.
+     */
+    class Version
+    {
+    public:
+        /**
+         * \brief Supported pre-release tags, in ascending order of precedence.
+         */
+        enum class PreRelease : uint8_t
+        {
+            Alpha = 1,
+            Beta = 2,
+            Rc = 3,
+            None = 15
+        };
+
+    private:
+        // major (32) | minor (32)
+        uint64_t high{0};
+        // patch (32) | build (16) | pre-release tag (4) | pre-release number (12)
+        uint64_t low{static_cast<uint64_t>(PreRelease::None) << 12};
+
+        static constexpr uint64_t MaxComponent = UINT32_MAX;
+        static constexpr uint64_t MaxBuild = UINT16_MAX;
+        static constexpr uint64_t MaxPreReleaseNumber = 0xFFF;
+
+        static constexpr bool IsDigit(const char c) { return c >= '0' && c <= '9'; }
+
+        static constexpr char ToLower(const char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c; }
+
+        static constexpr bool EqualsIgnoreCase(const std::string_view lhs, const std::string_view rhs)
+        {
+            if (lhs.size() != rhs.size())
+            {
+                return false;
+            }
+
+            for (size_t index = 0; index < lhs.size(); index++)
+            {
+                if (ToLower(lhs[index]) != ToLower(rhs[index]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * \brief Consumes a decimal number from the front of the text.
+         */
+        static constexpr bool ParseNumber(std::string_view& text, const uint64_t max, uint64_t& value)
+        {
+            size_t length = 0;
+            value = 0;
+
+            while (length < text.size() && IsDigit(text[length]))
+            {
+                value = value * 10 + static_cast<uint64_t>(text[length] - '0');
+
+                if (value > max)
+                {
+                    return false;
+                }
+
+                length++;
+            }
+
+            text.remove_prefix(length);
+
+            return length > 0;
+        }
+
+    public:
+        constexpr Version() = default;
+
+        constexpr Version(const uint32_t major, const uint32_t minor, const uint32_t patch, const uint16_t build = 0,
+                          const PreRelease tag = PreRelease::None, const uint16_t tagNumber = 0)
+            : high(static_cast<uint64_t>(major) << 32 | minor),
+              low(static_cast<uint64_t>(patch) << 32 | static_cast<uint64_t>(build) << 16 |
+                  static_cast<uint64_t>(tag) << 12 | (tagNumber & MaxPreReleaseNumber))
+        {
+        }
+
+        [[nodiscard]] constexpr uint32_t Major() const { return static_cast<uint32_t>(high >> 32); }
+        [[nodiscard]] constexpr uint32_t Minor() const { return static_cast<uint32_t>(high); }
+        [[nodiscard]] constexpr uint32_t Patch() const { return static_cast<uint32_t>(low >> 32); }
+        [[nodiscard]] constexpr uint16_t Build() const { return static_cast<uint16_t>(low >> 16); }
+        [[nodiscard]] constexpr PreRelease Tag() const { return static_cast<PreRelease>(low >> 12 & 0xF); }
+        [[nodiscard]] constexpr uint16_t TagNumber() const { return static_cast<uint16_t>(low & MaxPreReleaseNumber); }
+
+        /**
+         * \brief The upper half of the ordering key.
+         */
+        [[nodiscard]] constexpr uint64_t KeyHigh() const { return high; }
+
+        /**
+         * \brief The lower half of the ordering key.
+         */
+        [[nodiscard]] constexpr uint64_t KeyLow() const { return low; }
+
+        /**
+         * \brief Restores a version from the ordering key returned by KeyHigh and KeyLow.
+         */
+        static constexpr Version FromKey(const uint64_t keyHigh, const uint64_t keyLow)
+        {
+            Version version;
+            version.high = keyHigh;
+            version.low = keyLow;
+            return version;
+        }
+
+        constexpr auto operator<=>(const Version&) const = default;
+
+        /**
+         * \brief Parses a version string.
+         * \param text The version, surrounding whitespace and a "v" prefix are ignored.
+         * \return The version or empty if the string isn't a supported version format.
+         */
+        static constexpr std::optional<Version> Parse(std::string_view text) noexcept
+        {
+            while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+                text.remove_prefix(1);
+
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\0'))
+                text.remove_suffix(1);
+
+            if (!text.empty() && (text.front() == 'v' || text.front() == 'V'))
+                text.remove_prefix(1);
+
+            uint64_t components[4] = {0, 0, 0, 0};
+            size_t count = 0;
+
+            while (count < 4)
+            {
+                if (!ParseNumber(text, count == 3 ? MaxBuild : MaxComponent, components[count]))
+                {
+                    return std::nullopt;
+                }
+
+                count++;
+
+                if (text.empty() || text.front() != '.')
+                {
+                    break;
+                }
+
+                text.remove_prefix(1);
+            }
+
+            auto tag = PreRelease::None;
+            uint64_t tagNumber = 0;
+
+            if (!text.empty() && text.front() == '-')
+            {
+                text.remove_prefix(1);
+
+                size_t length = 0;
+
+                while (length < text.size() && !IsDigit(text[length]) && text[length] != '.' && text[length] != '+')
+                    length++;
+
+                const auto name = text.substr(0, length);
+                text.remove_prefix(length);
+
+                if (EqualsIgnoreCase(name, "alpha") || EqualsIgnoreCase(name, "a"))
+                    tag = PreRelease::Alpha;
+                else if (EqualsIgnoreCase(name, "beta") || EqualsIgnoreCase(name, "b"))
+                    tag = PreRelease::Beta;
+                else if (EqualsIgnoreCase(name, "rc"))
+                    tag = PreRelease::Rc;
+                else
+                    return std::nullopt;
+
+                if (!text.empty() && text.front() == '.')
+                    text.remove_prefix(1);
+
+                if (!text.empty() && IsDigit(text.front()) && !ParseNumber(text, MaxPreReleaseNumber, tagNumber))
+                    return std::nullopt;
+            }
+
+            // build metadata doesn't participate in precedence
+            if (!text.empty() && text.front() != '+')
+            {
+                return std::nullopt;
+            }
+
+            return Version(
+                static_cast<uint32_t>(components[0]),
+                static_cast<uint32_t>(components[1]),
+                static_cast<uint32_t>(components[2]),
+                static_cast<uint16_t>(components[3]),
+                tag,
+                static_cast<uint16_t>(tagNumber)
+            );
+        }
+
+        /**
+         * \brief Formats the version, the fourth component is only included if set.
+         */
+        [[nodiscard]] std::string ToString() const
+        {
+            std::string result = std::format("{}.{}.{}", Major(), Minor(), Patch());
+
+            if (Build() != 0)
+            {
+                result += std::format(".{}", Build());
+            }
+
+            switch (Tag())
+            {
+            case PreRelease::Alpha:
+                result += std::format("-alpha.{}", TagNumber());
+                break;
+            case PreRelease::Beta:
+                result += std::format("-beta.{}", TagNumber());
+                break;
+            case PreRelease::Rc:
+                result += std::format("-rc.{}", TagNumber());
+                break;
+            case PreRelease::None:
+                break;
+            }
+
+            return result;
+        }
+    };
+}
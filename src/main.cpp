@@ -3,6 +3,7 @@
 #include "WizardPage.h"
 #include "InstanceConfig.hpp"
 #include "DownloadAndInstall.hpp"
+#include "Hashing.hpp"
 
 
 //
@@ -43,6 +44,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
     // updater configuration, defaults and app state
     models::InstanceConfig cfg(hInstance, cmdl);
 
+    // measures the hashing kernels of this machine, combine with --log-to-file to see the results
+    if (cmdl[{NV_CLI_HASH_BENCHMARK}])
+    {
+        hashing::RunBenchmark();
+        return NV_S_HASH_BENCHMARK;
+    }
+
     // actions to perform when install is instructed
 #if !defined(NV_FLAGS_ALWAYS_RUN_INSTALL)
     if (cmdl[{NV_CLI_INSTALL}])
@@ -114,6 +122,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
         }
     }
 
+    // local detection doesn't need the server response, overlap it with the request
+    cfg.StartProductDetection();
+
     // contact update server and get latest state and config
     if (const auto ret = cfg.RequestUpdateInfo(); !std::get<0>(ret))
     {
@@ -305,6 +316,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
         {
         case WizardPage::Start:
             {
+                // get the changelog going while the user makes up their mind
+                cfg.PrefetchReleaseSummary();
+
                 ImGui::Indent(leftBorderIndent);
                 ImGui::PushFont(G_Font_H1);
                 ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 30);
@@ -344,6 +358,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
                 ImGui::Text("Update Summary");
                 ImGui::PopFont();
 
+                const bool isSummaryAvailable = cfg.IsReleaseSummaryAvailable();
                 const auto& release = cfg.GetSelectedRelease();
                 ImGuiWindowFlags windowFlags = ImGuiWindowFlags_HorizontalScrollbar;
                 ImGui::BeginChild(
@@ -352,7 +367,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
                     false,
                     windowFlags
                 );
-                markdown::RenderChangelog(release.summary);
+                if (isSummaryAvailable)
+                {
+                    markdown::RenderChangelog(release.summary);
+                }
+                else
+                {
+                    ImGui::Text("Loading summary...");
+                    ui::IndeterminateProgressBar(ImVec2(ImGui::GetContentRegionAvail().x - leftBorderIndent, 0.0f));
+                }
                 ImGui::EndChild();
 
                 ImGui::SetCursorPos(ImVec2(530, navigateButtonOffsetY));
@@ -433,6 +456,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
                     instStep = statusCode == 200
                                    ? DownloadAndInstallStep::DownloadSucceeded
                                    : DownloadAndInstallStep::DownloadFailed;
+
+                    // the setup must never be launched if it's not the one the server announced
+                    if (instStep == DownloadAndInstallStep::DownloadSucceeded &&
+                        !cfg.GetSelectedRelease().isChecksumValid.value_or(true))
+                    {
+                        instStep = DownloadAndInstallStep::ChecksumMismatch;
+                    }
                 }
 
                 switch (instStep)
@@ -459,6 +489,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine,
 
                     // TODO: implement me, allow retries
 
+                    break;
+                case DownloadAndInstallStep::ChecksumMismatch:
+
+                    ImGui::Text("Error! The downloaded file is corrupted or has been tampered with.");
+
                     break;
                 case DownloadAndInstallStep::PrepareInstall:
                     {
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <optional>
+#include <span>
+
+namespace models
+{
+    /**
+     * \brief How the results of the rules of a composite detection are combined.
+     */
+    enum class DetectionMode
+    {
+        /** Up to date if all rules find the product up to date */
+        All,
+        /** Up to date if any rule finds the product up to date, rules failing with an error count as outdated */
+        Any,
+        /** The first rule that can be evaluated decides, in the given order */
+        FirstMatch,
+        Invalid = -1
+    };
+
+    /**
+     * \brief What a single rule found out about the installed product.
+     */
+    enum class DetectionVerdict
+    {
+        /** The rule couldn't be evaluated */
+        Failed,
+        UpToDate,
+        Outdated
+    };
+
+    /**
+     * \brief Checks if a verdict settles the result of the whole detection.
+     */
+    constexpr bool IsConclusive(const DetectionMode mode, const DetectionVerdict verdict)
+    {
+        switch (mode)
+        {
+        case DetectionMode::All:
+            // an error can't be outweighed by the other rules
+            return verdict != DetectionVerdict::UpToDate;
+        case DetectionMode::Any:
+            return verdict == DetectionVerdict::UpToDate;
+        case DetectionMode::FirstMatch:
+            return verdict != DetectionVerdict::Failed;
+        default:
+            return true;
+        }
+    }
+
+    /**
+     * \brief Combines the verdicts of the rules in evaluation order.
+     * \return Whether the installed product is outdated, empty if the failed rules leave that open.
+     */
+    constexpr std::optional<bool> CombineVerdicts(const DetectionMode mode,
+                                                  const std::span<const DetectionVerdict> verdicts)
+    {
+        bool isAnyEvaluated = false;
+
+        for (const auto verdict : verdicts)
+        {
+            if (IsConclusive(mode, verdict))
+            {
+                if (verdict == DetectionVerdict::Failed)
+                {
+                    return std::nullopt;
+                }
+
+                return verdict == DetectionVerdict::Outdated;
+            }
+
+            isAnyEvaluated |= verdict != DetectionVerdict::Failed;
+        }
+
+        switch (mode)
+        {
+        case DetectionMode::All:
+            // all rules agree
+            return false;
+        case DetectionMode::Any:
+            // none found it up to date, but at least one must have looked
+            if (isAnyEvaluated)
+            {
+                return true;
+            }
+            return std::nullopt;
+        default:
+            return std::nullopt;
+        }
+    }
+}
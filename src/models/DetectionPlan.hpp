@@ -0,0 +1,139 @@
+#pragma once
+#include "UpdateResponse.hpp"
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief The decoded parameters of a single detection method.
+     */
+    using DetectionParameters = std::variant<
+        RegistryValueConfig,
+        FileSizeConfig,
+        FileVersionConfig,
+        FileChecksumConfig,
+        FileManifestConfig
+    >;
+
+    /**
+     * \brief A detection method ready to be evaluated.
+     */
+    class DetectionStep
+    {
+    public:
+        ProductVersionDetectionMethod method{ProductVersionDetectionMethod::Invalid};
+        DetectionParameters parameters;
+        /** Estimated relative cost, lower runs first */
+        int cost{0};
+    };
+
+    /**
+     * \brief What a detection step found out about the installed product.
+     */
+    class DetectionOutcome
+    {
+    public:
+        ProductVersionDetectionMethod method{ProductVersionDetectionMethod::Invalid};
+        /** True and "OK" on success, false and the error message otherwise */
+        std::tuple<bool, std::string> status{false, ""};
+        /** The installed version, set by methods that read it, as comparing needs the selected release */
+        std::optional<util::Version> installedVersion;
+        /** Set by methods that compare the installed files directly */
+        bool isOutdated{false};
+        /** The differing files, set by the manifest method */
+        std::vector<FileManifestMismatch> mismatches;
+
+        [[nodiscard]] bool IsSuccess() const { return std::get<0>(status); }
+
+        /**
+         * \brief Checks if the installed product is older than the given release.
+         */
+        [[nodiscard]] bool IsOutdated(const util::Version& releaseVersion) const
+        {
+            return installedVersion.has_value() ? releaseVersion > installedVersion.value() : isOutdated;
+        }
+
+        /**
+         * \brief Condenses the outcome for combining it with the other steps of the plan.
+         */
+        [[nodiscard]] DetectionVerdict GetVerdict(const util::Version& releaseVersion) const
+        {
+            if (!IsSuccess())
+            {
+                return DetectionVerdict::Failed;
+            }
+
+            return IsOutdated(releaseVersion) ? DetectionVerdict::Outdated : DetectionVerdict::UpToDate;
+        }
+    };
+
+    /**
+     * \brief The detection configuration, decoded once and ordered for evaluation.
+     * \remarks Steps of All and Any plans are ordered by ascending cost, so the evaluation can stop at
+     *          the first conclusive cheap step before ever reaching a hash. FirstMatch plans keep the
+     *          configured order as it expresses priority.
+     */
+    class DetectionPlan
+    {
+    public:
+        DetectionMode mode{DetectionMode::All};
+        std::vector<DetectionStep> steps;
+
+        /**
+         * \brief Estimates the relative cost of a detection method.
+         */
+        static constexpr int EstimateCost(const ProductVersionDetectionMethod method)
+        {
+            switch (method)
+            {
+            case ProductVersionDetectionMethod::RegistryValue:
+                return 1;
+            case ProductVersionDetectionMethod::FileSize:
+                return 2;
+            case ProductVersionDetectionMethod::FileVersion:
+                return 3;
+            case ProductVersionDetectionMethod::FileChecksum:
+                return 4;
+            case ProductVersionDetectionMethod::FileManifest:
+                return 5;
+            default:
+                return INT_MAX;
+            }
+        }
+
+        /**
+         * \brief Checks if a step hashes file contents, which can take long on big installations.
+         */
+        static constexpr bool IsHashing(const ProductVersionDetectionMethod method)
+        {
+            return EstimateCost(method) >= EstimateCost(ProductVersionDetectionMethod::FileChecksum);
+        }
+
+        /**
+         * \brief Checks if an outcome settles the result of the whole plan.
+         * \param outcome The outcome of one of the steps.
+         * \param releaseVersion The version of the selected release, empty if not known yet.
+         * \return True if no further steps need to be evaluated.
+         */
+        [[nodiscard]] bool IsConclusive(const DetectionOutcome& outcome,
+                                        const std::optional<util::Version>& releaseVersion) const
+        {
+            // a version read early can't be compared yet, only an ordered list of fallbacks is done with it
+            if (outcome.IsSuccess() && outcome.installedVersion.has_value() && !releaseVersion.has_value())
+            {
+                return mode == DetectionMode::FirstMatch;
+            }
+
+            return models::IsConclusive(mode, outcome.GetVerdict(releaseVersion.value_or(util::Version{})));
+        }
+
+        /**
+         * \brief Decodes the detection configuration.
+         * \param method The detection method, Composite to combine several rules.
+         * \param detection The parameters of the method.
+         * \return The plan or empty if the configuration is invalid.
+         */
+        static std::optional<DetectionPlan> Compile(ProductVersionDetectionMethod method, const json& detection);
+    };
+}
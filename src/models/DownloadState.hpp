@@ -0,0 +1,55 @@
+#pragma once
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief Progress of one byte range of a partial download.
+     */
+    class DownloadSegmentState
+    {
+    public:
+        /** Offset of the first byte */
+        int64_t begin{0};
+        /** Offset of the last byte (inclusive) */
+        int64_t end{-1};
+        /** Offset of the next byte to write, everything before it is on disk */
+        int64_t cursor{0};
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(DownloadSegmentState, begin, end, cursor)
+
+    /**
+     * \brief Persisted state of an unfinished release download, used to resume it in a later run.
+     */
+    class DownloadState
+    {
+    public:
+        /** The remote payload URL */
+        std::string url;
+        /** The mirror the validators belong to, the payload URL if empty */
+        std::string sourceUrl;
+        /** The ETag validator of the remote file, if any */
+        std::string etag;
+        /** The Last-Modified validator of the remote file, if any */
+        std::string lastModified;
+        /** Size of the remote file */
+        int64_t totalSize{-1};
+        /** Full pathname of the local partial file */
+        std::string tempFile;
+        /** Progress of each byte range */
+        std::vector<DownloadSegmentState> segments;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+        DownloadState,
+        url,
+        sourceUrl,
+        etag,
+        lastModified,
+        totalSize,
+        tempFile,
+        segments
+    )
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief Last successful update information response, persisted to avoid needless requests.
+     * \remarks The response body itself is stored as received in a separate file, next to the model
+     *          deserialized from it, so a fresh or revalidated response isn't parsed again.
+     */
+    class FeedCache
+    {
+    public:
+        /** The request URL the response belongs to */
+        std::string url;
+        /** The location that actually served the response, e.g. a precompressed sibling of the URL */
+        std::string sourceUrl;
+        /** The ETag validator of the response, if any */
+        std::string etag;
+        /** The Last-Modified validator of the response, if any */
+        std::string lastModified;
+        /** The Content-Type of the stored (decoded) body, JSON is assumed if empty */
+        std::string contentType;
+        /** When the response was received or last revalidated, in seconds since epoch */
+        int64_t storedAt{0};
+        /** How many seconds the response is fresh after storedAt, 0 to always revalidate */
+        int64_t maxAge{0};
+
+        /**
+         * \brief Checks if the response may still be used without contacting the server.
+         */
+        [[nodiscard]] bool IsFresh() const
+        {
+            const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            return maxAge > 0 && now >= storedAt && now - storedAt < maxAge;
+        }
+
+        /**
+         * \brief Checks if the server can be asked whether the response is still current.
+         */
+        [[nodiscard]] bool CanRevalidate() const
+        {
+            return !etag.empty() || !lastModified.empty();
+        }
+
+        /**
+         * \brief Gets the remaining freshness lifetime from the Cache-Control and Age header values.
+         * \return The lifetime in seconds, 0 if the response must be revalidated, -1 if it must not be stored.
+         */
+        static int64_t GetMaxAge(const std::string& cacheControl, const std::string& age)
+        {
+            int64_t maxAge = 0;
+
+            std::stringstream directives(cacheControl);
+            std::string directive;
+
+            while (std::getline(directives, directive, ','))
+            {
+                directive = util::trim(directive);
+
+                if (util::icompare(directive, "no-store"))
+                {
+                    return -1;
+                }
+
+                if (util::icompare(directive, "no-cache"))
+                {
+                    return 0;
+                }
+
+                if (directive.size() > 8 && util::icompare(directive.substr(0, 8), "max-age="))
+                {
+                    try
+                    {
+                        maxAge = std::stoll(directive.substr(8));
+                    }
+                    catch (...)
+                    {
+                        maxAge = 0;
+                    }
+                }
+            }
+
+            // time the response already spent in intermediate caches
+            if (!age.empty())
+            {
+                try
+                {
+                    maxAge -= std::stoll(age);
+                }
+                catch (...)
+                {
+                }
+            }
+
+            return std::max<int64_t>(maxAge, 0);
+        }
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+        FeedCache,
+        url,
+        sourceUrl,
+        etag,
+        lastModified,
+        contentType,
+        storedAt,
+        maxAge
+    )
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "UpdateResponse.hpp"
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief Identifies the exact state of a file without reading its content.
+     * \remarks Any write updates the last write time, replacing the file changes its index.
+     */
+    class FileIdentity
+    {
+    public:
+        /** The path as it was hashed */
+        std::string path;
+        /** Size in bytes */
+        uint64_t size{0};
+        /** Last write time as FILETIME, in 100 ns intervals since 1601 */
+        int64_t lastWriteTime{0};
+        /** Serial number of the volume the file lives on */
+        uint32_t volumeSerial{0};
+        /** Index of the file on its volume */
+        uint64_t fileIndex{0};
+
+        bool operator==(const FileIdentity&) const = default;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(FileIdentity, path, size, lastWriteTime, volumeSerial, fileIndex)
+
+    /**
+     * \brief A digest calculated earlier.
+     */
+    class CachedDigest
+    {
+    public:
+        ChecksumAlgorithm algorithm{ChecksumAlgorithm::Invalid};
+        std::vector<uint8_t> digest;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(CachedDigest, algorithm, digest)
+
+    /**
+     * \brief The digests of a file, valid as long as its identity doesn't change.
+     */
+    class HashCacheEntry
+    {
+    public:
+        FileIdentity identity;
+        std::vector<CachedDigest> digests;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(HashCacheEntry, identity, digests)
+
+    /**
+     * \brief File digests remembered across runs to skip rehashing unchanged files.
+     */
+    class HashCache
+    {
+    public:
+        std::vector<HashCacheEntry> entries;
+
+        /**
+         * \brief Looks up the digest of a file.
+         * \return The digest or nullptr if the file changed or wasn't hashed with the algorithm yet.
+         */
+        [[nodiscard]] const std::vector<uint8_t>* Find(const FileIdentity& identity,
+                                                       const ChecksumAlgorithm algorithm) const
+        {
+            const auto entry = std::ranges::find(entries, identity, &HashCacheEntry::identity);
+
+            if (entry == entries.end())
+            {
+                return nullptr;
+            }
+
+            const auto cached = std::ranges::find(entry->digests, algorithm, &CachedDigest::algorithm);
+
+            return cached == entry->digests.end() ? nullptr : &cached->digest;
+        }
+
+        /**
+         * \brief Remembers the digest of a file, dropping whatever was known about an earlier state of it.
+         */
+        void Store(const FileIdentity& identity, const ChecksumAlgorithm algorithm, std::vector<uint8_t> digest)
+        {
+            auto entry = std::ranges::find(entries, identity.path, [](const HashCacheEntry& candidate)
+            {
+                return candidate.identity.path;
+            });
+
+            if (entry == entries.end())
+            {
+                entry = entries.insert(entries.end(), HashCacheEntry{.identity = identity});
+            }
+            else if (entry->identity != identity)
+            {
+                *entry = HashCacheEntry{.identity = identity};
+            }
+
+            const auto cached = std::ranges::find(entry->digests, algorithm, &CachedDigest::algorithm);
+
+            if (cached == entry->digests.end())
+            {
+                entry->digests.push_back({algorithm, std::move(digest)});
+            }
+            else
+            {
+                cached->digest = std::move(digest);
+            }
+        }
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(HashCache, entries)
+}
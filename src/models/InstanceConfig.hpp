@@ -3,6 +3,7 @@
 #include <curl/curl.h>
 
 #include "UpdateResponse.hpp"
+#include "DetectionPlan.hpp"
 
 using json = nlohmann::json;
 
@@ -37,7 +38,7 @@ namespace models
 		/** Full pathname of the updater process file */
 		std::filesystem::path appPath;
 		/** The updater application version */
-		semver::version appVersion;
+		util::Version appVersion;
 		/** Filename of the updater file without extension */
 		std::string appFilename;
 		/** The manufacturer name */
@@ -48,19 +49,68 @@ namespace models
 		std::string tenantSubPath;
 		/** URL of the update request */
 		std::string updateRequestUrl;
+		/** The update information URLs of all mirrors, in configured order, the first one is updateRequestUrl */
+		std::vector<std::string> updateRequestUrls;
+		/** Per-user directory for state persisted across runs */
+		std::filesystem::path localDataPath;
 
 		/** The local and remote shared configuration */
 		MergedConfig merged;
 		/** The remote API response */
 		UpdateResponse remote;
+		/** Stall detection limits of release downloads, local values overridden by the server */
+		TransferTimeouts downloadTimeouts;
+		/** The detection configuration decoded for evaluation, compiled on first use */
+		std::optional<DetectionPlan> detectionPlan;
+		/** Pending background detection, started before the server response is known */
+		std::optional<std::future<std::vector<DetectionOutcome>>> detectionTask;
+		/** Files found to differ by the last manifest detection */
+		std::vector<FileManifestMismatch> manifestMismatches;
+
+		/** Releases decoded from the index so far, by release ID */
+		std::map<int, UpdateRelease> materializedReleases;
+		/** Pending summary download */
+		std::optional<std::shared_future<std::string>> summaryTask;
+		/** The release ID the pending summary download belongs to */
+		int summaryTaskRelease{-1};
 
 		std::optional<std::shared_future<int>> downloadTask;
+		std::atomic<bool> isDownloadCancelled{false};
 		int selectedRelease{0};
 		bool isSilent{false};
 
 		int DownloadRelease(curl_progress_callback progressFn, int releaseIndex);
 
-		void SetCommonHeaders(RestClient::Connection* conn) const;
+		std::string FetchReleaseSummary(const std::string& url, const std::optional<ChecksumParameters>& checksum) const;
+
+		RestClient::HeaderFields GetCommonHeaders() const;
+
+		std::tuple<bool, std::string> ApplyUpdateResponse(UpdateResponse&& response);
+
+		/**
+		 * \brief Evaluates a single detection method, safe to call from a worker thread.
+		 * \param cfg The parameters of the method.
+		 * \param outcome Receives the installed version or whether the installed files differ.
+		 * \return True if detection succeeded, false on error.
+		 */
+		std::tuple<bool, std::string> Detect(const RegistryValueConfig& cfg, DetectionOutcome& outcome) const;
+		std::tuple<bool, std::string> Detect(const FileVersionConfig& cfg, DetectionOutcome& outcome) const;
+		std::tuple<bool, std::string> Detect(const FileSizeConfig& cfg, DetectionOutcome& outcome) const;
+		std::tuple<bool, std::string> Detect(const FileChecksumConfig& cfg, DetectionOutcome& outcome) const;
+		std::tuple<bool, std::string> Detect(const FileManifestConfig& cfg, DetectionOutcome& outcome) const;
+
+		/**
+		 * \brief Evaluates the steps of a detection plan until the result is certain.
+		 * \param plan The plan to evaluate.
+		 * \param releaseVersion The version of the selected release, empty if not known yet.
+		 * \param outcomes Outcomes of the leading steps from an earlier call, evaluation resumes after them.
+		 * \param isHashingAllowed False to stop before the first step hashing file contents.
+		 * \return The outcomes of the evaluated steps, in plan order.
+		 */
+		std::vector<DetectionOutcome> ProbeInstalledProduct(const DetectionPlan& plan,
+		                                                    const std::optional<util::Version>& releaseVersion,
+		                                                    std::vector<DetectionOutcome> outcomes,
+		                                                    bool isHashingAllowed) const;
 
 	public:
 		std::string serverUrlTemplate;
@@ -68,7 +118,8 @@ namespace models
 		Authority authority;
 
 		std::filesystem::path GetAppPath() const { return appPath; }
-		semver::version GetAppVersion() const { return appVersion; }
+		std::filesystem::path GetLocalDataPath() const;
+		util::Version GetAppVersion() const { return appVersion; }
 		std::string GetAppFilename() const { return appFilename; }
 
 		std::string GetWindowTitle() const { return merged.windowTitle; }
@@ -76,7 +127,7 @@ namespace models
 
 		bool SetSelectedRelease(const int releaseIndex = 0)
 		{
-			if (releaseIndex < 0 || releaseIndex >= static_cast<int>(remote.releases.size()))
+			if (releaseIndex < 0 || releaseIndex >= static_cast<int>(remote.releases.GetEnabledCount()))
 			{
 				return false;
 			}
@@ -88,12 +139,25 @@ namespace models
 
 		std::filesystem::path GetLocalReleaseTempFilePath(const int releaseId = 0) const
 		{
-			return remote.releases[releaseId].localTempFilePath;
+			const auto release = materializedReleases.find(releaseId);
+
+			return release == materializedReleases.end() ? std::filesystem::path{} : release->second.localTempFilePath;
 		}
 
 		UpdateRelease& GetSelectedRelease()
 		{
-			return remote.releases[selectedRelease];
+			auto release = materializedReleases.find(selectedRelease);
+
+			// only the releases actually looked at get decoded
+			if (release == materializedReleases.end())
+			{
+				release = materializedReleases.emplace(
+					selectedRelease,
+					remote.releases.Materialize(remote.releases.GetEnabledRow(selectedRelease))
+				).first;
+			}
+
+			return release->second;
 		}
 
 		int GetSelectedReleaseId() const
@@ -112,16 +176,14 @@ namespace models
 		 * \param currentVersion The local product version to check against.
 		 * \return True if a newer version is available, false otherwise.
 		 */
-		[[nodiscard]] bool IsProductUpdateAvailable(const semver::version& currentVersion)
+		[[nodiscard]] bool IsProductUpdateAvailable(const util::Version& currentVersion)
 		{
-			if (remote.releases.empty())
+			if (remote.releases.GetEnabledCount() == 0)
 			{
 				return false;
 			}
 
-			const auto latest = GetSelectedRelease().GetSemVersion();
-
-			return latest > currentVersion;
+			return remote.releases.GetVersion(remote.releases.GetEnabledRow(selectedRelease)) > currentVersion;
 		}
 
         /**
@@ -138,7 +200,7 @@ namespace models
             if (remote.instance.value().latestVersion.has_value() &&
                 remote.instance.value().latestUrl.has_value())
             {
-                const auto latest = remote.instance.value().GetSemVersion();
+                const auto latest = remote.instance.value().GetVersion();
 
                 return latest > appVersion;
             }
@@ -152,7 +214,7 @@ namespace models
 		 */
 		[[nodiscard]] bool HasSingleRelease() const
 		{
-			return remote.releases.size() == 1;
+			return remote.releases.GetEnabledCount() == 1;
 		}
 
 		/**
@@ -161,7 +223,7 @@ namespace models
 		 */
 		[[nodiscard]] bool HasMultipleReleases() const
 		{
-			return remote.releases.size() > 1;
+			return remote.releases.GetEnabledCount() > 1;
 		}
 
 		/**
@@ -185,6 +247,31 @@ namespace models
 		 */
 		void ResetReleaseDownloadState();
 
+		/**
+		 * \brief Aborts a running download, its progress is kept for the next attempt.
+		 */
+		void CancelReleaseDownload();
+
+		/**
+		 * \brief Starts fetching the summary of the selected release in the background, if it isn't inline.
+		 */
+		void PrefetchReleaseSummary();
+
+		/**
+		 * \brief Checks if the summary of the selected release can be displayed, never blocks.
+		 * \return True if the summary is present, false while it's still being fetched.
+		 */
+		bool IsReleaseSummaryAvailable();
+
+		/**
+		 * \brief Starts detecting the installed product in the background, e.g. while the update information
+		 *        is fetched. Does nothing if there's no local detection configuration.
+		 * \remarks Only the steps up to the first hashing one run early. IsInstalledVersionOutdated picks up
+		 *          the result and hashes only if that didn't settle it, unless the server replaced the detection
+		 *          configuration in the meantime, which makes it detect again.
+		 */
+		void StartProductDetection();
+
 		/**
 		 * \brief Checks the version of the installed product against the latest available release.
 		 * \param isOutdated True if the detected installed version is older than the latest server release.
@@ -192,6 +279,12 @@ namespace models
 		 */
 		std::tuple<bool, std::string> IsInstalledVersionOutdated(bool& isOutdated);
 
+		/**
+		 * \brief Gets the files found to differ by the last manifest detection run.
+		 * \return The differing files, empty if the product matches or another detection method is used.
+		 */
+		const std::vector<FileManifestMismatch>& GetManifestMismatches() const { return manifestMismatches; }
+
 		std::tuple<HRESULT, std::string> CreateScheduledTask(const std::string& launchArgs = NV_CLI_BACKGROUND) const;
 
 		std::tuple<HRESULT, std::string> RemoveScheduledTask() const;
@@ -0,0 +1,182 @@
+#pragma once
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief How a single mirror performed in earlier runs.
+     */
+    class MirrorRecord
+    {
+    public:
+        /** The URL requested from the mirror */
+        std::string url;
+        /** Smoothed time in milliseconds until the mirror delivered a complete response, 0 if unknown */
+        int64_t latency{0};
+        /** Smoothed download speed in bytes per second, 0 if unknown */
+        int64_t throughput{0};
+        /** Failed requests in a row, reset by the next successful one */
+        int failures{0};
+        /** When the mirror was last used, in seconds since epoch */
+        int64_t updatedAt{0};
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(MirrorRecord, url, latency, throughput, failures, updatedAt)
+
+    /**
+     * \brief Mirror performance remembered across runs to prefer the fastest ones.
+     */
+    class MirrorHistory
+    {
+    public:
+        std::vector<MirrorRecord> mirrors;
+
+        /**
+         * \brief Looks up the record of a mirror, creates an empty one if it's not known yet.
+         */
+        MirrorRecord& Get(const std::string& url)
+        {
+            const auto record = std::ranges::find(mirrors, url, &MirrorRecord::url);
+
+            if (record != mirrors.end())
+            {
+                return *record;
+            }
+
+            return mirrors.emplace_back(MirrorRecord{.url = url});
+        }
+
+        /**
+         * \brief Accounts the outcome of a request.
+         * \param url The URL requested from the mirror.
+         * \param isSuccess True if the mirror delivered.
+         * \param elapsed How long the request took.
+         */
+        void Record(const std::string& url, const bool isSuccess, const std::chrono::milliseconds elapsed)
+        {
+            auto& record = Get(url);
+
+            record.updatedAt = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            if (!isSuccess)
+            {
+                record.failures++;
+                return;
+            }
+
+            record.failures = 0;
+            // weighted so a single outlier doesn't flip the ranking
+            record.latency = record.latency == 0
+                                 ? elapsed.count()
+                                 : (record.latency * 7 + elapsed.count() * 3) / 10;
+        }
+
+        /**
+         * \brief Accounts a request that got cancelled because another mirror answered first.
+         * \remarks Such a mirror is known to be at least this slow, but not how much slower, so the
+         *          remembered latency can only grow.
+         * \param url The URL requested from the mirror.
+         * \param atLeast The time the request could have taken without losing the race.
+         */
+        void RecordLowerBound(const std::string& url, const std::chrono::milliseconds atLeast)
+        {
+            auto& record = Get(url);
+
+            record.updatedAt = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            if (record.latency < atLeast.count())
+            {
+                record.latency = record.latency == 0
+                                     ? atLeast.count()
+                                     : (record.latency * 7 + atLeast.count() * 3) / 10;
+            }
+        }
+
+        /**
+         * \brief Accounts the outcome of a payload transfer.
+         * \param url The URL requested from the mirror.
+         * \param isSuccess True if the mirror delivered.
+         * \param bytes How much was received.
+         * \param elapsed How long receiving it took.
+         */
+        void RecordThroughput(const std::string& url, const bool isSuccess, const int64_t bytes,
+                              const std::chrono::milliseconds elapsed)
+        {
+            auto& record = Get(url);
+
+            record.updatedAt = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            record.failures = isSuccess ? 0 : record.failures + 1;
+
+            if (bytes <= 0 || elapsed.count() <= 0)
+            {
+                return;
+            }
+
+            const int64_t sample = bytes * 1000 / elapsed.count();
+
+            // a mirror breaking down mid-transfer still tells how fast it was until then
+            record.throughput = record.throughput == 0
+                                    ? sample
+                                    : (record.throughput * 7 + sample * 3) / 10;
+        }
+
+        /**
+         * \brief Checks if earlier transfers or samples tell how the mirror performs.
+         * \remarks A failing mirror counts as known, it ranks last until a transfer from it succeeds.
+         */
+        [[nodiscard]] bool IsMeasured(const std::string& url) const
+        {
+            const auto record = std::ranges::find(mirrors, url, &MirrorRecord::url);
+
+            return record != mirrors.end() && (record->throughput > 0 || record->failures > 0);
+        }
+
+        /**
+         * \brief Orders the URLs by remembered throughput, failing ones last, ties keep the given order.
+         */
+        void RankByThroughput(std::vector<std::string>& urls) const
+        {
+            std::ranges::stable_sort(urls, [this](const std::string& lhs, const std::string& rhs)
+            {
+                const auto score = [this](const std::string& url)
+                {
+                    const auto record = std::ranges::find(mirrors, url, &MirrorRecord::url);
+
+                    return record == mirrors.end()
+                               ? std::make_pair(0, int64_t{0})
+                               : std::make_pair(record->failures, -record->throughput);
+                };
+
+                return score(lhs) < score(rhs);
+            });
+        }
+
+        /**
+         * \brief Orders the URLs by remembered performance.
+         * \remarks Unknown mirrors come first so they get measured, failing ones come last,
+         *          ties keep the given order.
+         */
+        void Rank(std::vector<std::string>& urls) const
+        {
+            std::ranges::stable_sort(urls, [this](const std::string& lhs, const std::string& rhs)
+            {
+                const auto score = [this](const std::string& url)
+                {
+                    const auto record = std::ranges::find(mirrors, url, &MirrorRecord::url);
+
+                    return record == mirrors.end()
+                               ? std::make_pair(0, int64_t{0})
+                               : std::make_pair(record->failures, record->latency);
+                };
+
+                return score(lhs) < score(rhs);
+            });
+        }
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(MirrorHistory, mirrors)
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+using json = nlohmann::json;
+
+namespace models
+{
+    /**
+     * \brief A resolved host address remembered across runs.
+     */
+    class ResolvedAddress
+    {
+    public:
+        /** The host name as it appears in the URL */
+        std::string host;
+        /** The port the address was connected on */
+        int port{0};
+        /** The numerical IPv4 or IPv6 address */
+        std::string address;
+        /** When the DNS record expires, in seconds since epoch */
+        int64_t expiresAt{0};
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(ResolvedAddress, host, port, address, expiresAt)
+
+    /**
+     * \brief A TLS session ticket remembered across runs.
+     */
+    class TlsSession
+    {
+    public:
+        /** curl's key of the peer the session belongs to, may be empty if only the hash is known */
+        std::string sessionKey;
+        /** Salted hash of the session key */
+        std::vector<uint8_t> shmac;
+        /** The session data, encrypted for the current user */
+        std::vector<uint8_t> data;
+        /** When the session stops being resumable, in seconds since epoch */
+        int64_t expiresAt{0};
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(TlsSession, sessionKey, shmac, data, expiresAt)
+
+    /**
+     * \brief Connection setup results persisted to speed up the first requests of the next run.
+     */
+    class NetworkCache
+    {
+    public:
+        std::vector<ResolvedAddress> addresses;
+        std::vector<TlsSession> sessions;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(NetworkCache, addresses, sessions)
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "Common.h"
 #include "ADL.hpp"
+#include "DetectionMode.hpp"
 
 using json = nlohmann::json;
 
@@ -14,6 +15,10 @@ namespace models
         MD5,
         SHA1,
         SHA256,
+        /** Cryptographic, large inputs are hashed on all cores */
+        BLAKE3,
+        /** XXH3 with 128 bit output, fast but not cryptographic, only fit for local change detection */
+        XXH128,
         Invalid = -1
     };
 
@@ -25,6 +30,10 @@ namespace models
                                  magic_enum::enum_name(ChecksumAlgorithm::SHA1)},
                                  {ChecksumAlgorithm::SHA256,
                                  magic_enum::enum_name(ChecksumAlgorithm::SHA256)},
+                                 {ChecksumAlgorithm::BLAKE3,
+                                 magic_enum::enum_name(ChecksumAlgorithm::BLAKE3)},
+                                 {ChecksumAlgorithm::XXH128,
+                                 magic_enum::enum_name(ChecksumAlgorithm::XXH128)},
                                  })
 
     /**
@@ -36,6 +45,9 @@ namespace models
         FileVersion,
         FileSize,
         FileChecksum,
+        FileManifest,
+        /** Combines several of the other methods */
+        Composite,
         Invalid = -1
     };
 
@@ -49,6 +61,10 @@ namespace models
                                  magic_enum::enum_name(ProductVersionDetectionMethod::FileSize)},
                                  {ProductVersionDetectionMethod::FileChecksum,
                                  magic_enum::enum_name(ProductVersionDetectionMethod::FileChecksum)},
+                                 {ProductVersionDetectionMethod::FileManifest,
+                                 magic_enum::enum_name(ProductVersionDetectionMethod::FileManifest)},
+                                 {ProductVersionDetectionMethod::Composite,
+                                 magic_enum::enum_name(ProductVersionDetectionMethod::Composite)},
                                  })
 
     /**
@@ -106,6 +122,85 @@ namespace models
 
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(FileChecksumConfig, path, algorithm, hash)
 
+    /**
+     * \brief A file expected in the product directory.
+     */
+    class FileManifestEntry
+    {
+    public:
+        /** Path relative to the manifest root */
+        std::string path;
+        /** The expected size in bytes */
+        size_t size;
+        /** The expected hash as hex string */
+        std::string hash;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(FileManifestEntry, path, size, hash)
+
+    class FileManifestConfig
+    {
+    public:
+        /** The absolute local path to the product directory */
+        std::string root;
+        ChecksumAlgorithm algorithm;
+        std::vector<FileManifestEntry> files;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(FileManifestConfig, root, algorithm, files)
+
+    NLOHMANN_JSON_SERIALIZE_ENUM(DetectionMode, {
+                                 {DetectionMode::Invalid, nullptr},
+                                 {DetectionMode::All, magic_enum::enum_name(DetectionMode::All)},
+                                 {DetectionMode::Any, magic_enum::enum_name(DetectionMode::Any)},
+                                 {DetectionMode::FirstMatch, magic_enum::enum_name(DetectionMode::FirstMatch)},
+                                 })
+
+    /**
+     * \brief A single detection method within a composite detection.
+     */
+    class DetectionRule
+    {
+    public:
+        ProductVersionDetectionMethod detectionMethod{ProductVersionDetectionMethod::Invalid};
+        /** The parameters of the detection method */
+        json detection;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(DetectionRule, detectionMethod, detection)
+
+    class CompositeDetectionConfig
+    {
+    public:
+        DetectionMode mode{DetectionMode::All};
+        std::vector<DetectionRule> rules;
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(CompositeDetectionConfig, mode, rules)
+
+    /**
+     * \brief Why a file doesn't match its manifest entry.
+     */
+    enum class FileMismatch
+    {
+        Missing,
+        Size,
+        Checksum,
+        /** The file exists but couldn't be hashed */
+        Unreadable
+    };
+
+    /**
+     * \brief A file of the manifest that differs from the local copy.
+     */
+    class FileManifestMismatch
+    {
+    public:
+        /** Path relative to the manifest root, as listed in the manifest */
+        std::string path;
+        FileMismatch reason;
+    };
+
     /**
      * \brief Parameters that might be provided by both the server and the local configuration.
      */
@@ -148,26 +243,6 @@ namespace models
         MergedConfig() : windowTitle(NV_WINDOW_TITLE), productName(NV_PRODUCT_NAME)
         {
         }
-
-        RegistryValueConfig GetRegistryValueConfig() const
-        {
-            return detection.get<RegistryValueConfig>();
-        }
-
-        FileVersionConfig GetFileVersionConfig() const
-        {
-            return detection.get<FileVersionConfig>();
-        }
-
-        FileSizeConfig GetFileSizeConfig() const
-        {
-            return detection.get<FileSizeConfig>();
-        }
-
-        FileChecksumConfig GetFileChecksumConfig() const
-        {
-            return detection.get<FileChecksumConfig>();
-        }
     };
 
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
@@ -192,6 +267,48 @@ namespace models
 
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(ExitCodeCheck, skipCheck, successCodes)
 
+    /**
+     * \brief Limits detecting stalled payload downloads, unset values keep the defaults.
+     */
+    class TransferTimeouts
+    {
+    public:
+        /** Seconds to wait for a connection to be established */
+        std::optional<int> connectTimeout;
+        /** Transfers slower than this many bytes per second... */
+        std::optional<int> lowSpeedLimit;
+        /** ...for this many seconds are considered stalled */
+        std::optional<int> lowSpeedTime;
+        /** Seconds without receiving any data after which a transfer is considered stalled */
+        std::optional<int> idleTimeout;
+
+        /**
+         * \brief Takes over all values the other instance has set.
+         */
+        void Merge(const TransferTimeouts& other)
+        {
+            if (other.connectTimeout.has_value())
+                connectTimeout = other.connectTimeout;
+
+            if (other.lowSpeedLimit.has_value())
+                lowSpeedLimit = other.lowSpeedLimit;
+
+            if (other.lowSpeedTime.has_value())
+                lowSpeedTime = other.lowSpeedTime;
+
+            if (other.idleTimeout.has_value())
+                idleTimeout = other.idleTimeout;
+        }
+    };
+
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
+        TransferTimeouts,
+        connectTimeout,
+        lowSpeedLimit,
+        lowSpeedTime,
+        idleTimeout
+    )
+
     /**
      * \brief Details about checksum/hash calculation.
      */
@@ -218,10 +335,16 @@ namespace models
         std::string version;
         /** The update summary/changelog, supports Markdown */
         std::string summary;
+        /** URL of the summary, fetched on demand if it isn't provided inline */
+        std::optional<std::string> summaryUrl;
+        /** The (optional) checksum of the summary behind summaryUrl */
+        std::optional<ChecksumParameters> summaryChecksum;
         /** The publishing timestamp as UTC ISO 8601 string */
         std::string publishedAt;
         /** URL of the new setup/release download */
         std::string downloadUrl;
+        /** Further URLs serving the identical file, the fastest one gets used */
+        std::vector<std::string> downloadMirrors;
         /** Size of the remote file */
         std::optional<size_t> downloadSize;
         /** The launch arguments (CLI arguments) if any */
@@ -232,26 +355,15 @@ namespace models
         std::optional<ChecksumParameters> checksum;
         /** If set, this release is ignored and not presented to the user */
         std::optional<bool> disabled;
+        /** The (optional) release channel, e.g. "beta" */
+        std::optional<std::string> channel;
 
         /** Full pathname of the local temporary file */
         std::filesystem::path localTempFilePath{};
-
-        /**
-         * \brief Converts the version string to a SemVer type.
-         * \return The parsed version.
-         */
-        semver::version GetSemVersion() const
-        {
-            try
-            {
-                // trim whitespaces and potential "v" prefix
-                return semver::version{util::trim(version, "v \t")};
-            }
-            catch (...)
-            {
-                return semver::version{0, 0, 0};
-            }
-        }
+        /** Outcome of the checksum verification of the downloaded file, empty if not verified */
+        std::optional<bool> isChecksumValid{};
+        /** The parsed version, invalid versions become 0.0.0 */
+        util::Version parsedVersion{};
     };
 
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
@@ -259,14 +371,105 @@ namespace models
         name,
         version,
         summary,
+        summaryUrl,
+        summaryChecksum,
         publishedAt,
         downloadUrl,
+        downloadMirrors,
         downloadSize,
         launchArguments,
         exitCode,
-        checksum
+        checksum,
+        disabled,
+        channel
     )
 
+    /**
+     * \brief Compact, version-ordered index over all releases of a response.
+     * \remarks Only the columns needed for lookups are kept decoded (struct of arrays), the full
+     *          records are stored CBOR-encoded and only materialized for the releases actually shown.
+     */
+    class ReleaseIndex
+    {
+        /** Version of each row, descending after Sort */
+        std::vector<util::Version> versions;
+        /** Disabled flag of each row */
+        std::vector<uint8_t> disabled;
+        /** Channel of each row, references channelNames */
+        std::vector<uint16_t> channels;
+        /** Offset of each row's record within records */
+        std::vector<uint32_t> offsets;
+        /** Length of each row's record */
+        std::vector<uint32_t> lengths;
+        /** The encoded records */
+        std::vector<uint8_t> records;
+        /** Distinct channel names, the first entry is the default (empty) channel */
+        std::vector<std::string> channelNames{""};
+        /** Rows that are not disabled, in version order */
+        std::vector<uint32_t> enabledRows;
+
+    public:
+        /**
+         * \brief Appends a release record, Sort must be called once all are added.
+         */
+        void Add(json&& record);
+
+        /**
+         * \brief Reserves space for the given number of releases.
+         */
+        void Reserve(size_t count);
+
+        /**
+         * \brief Orders all rows by descending version and rebuilds the enabled rows.
+         */
+        void Sort();
+
+        /**
+         * \brief Removes all releases.
+         */
+        void Clear();
+
+        [[nodiscard]] size_t Size() const { return versions.size(); }
+        [[nodiscard]] size_t GetEnabledCount() const { return enabledRows.size(); }
+        [[nodiscard]] size_t GetEnabledRow(const size_t position) const { return enabledRows[position]; }
+        [[nodiscard]] const util::Version& GetVersion(const size_t row) const { return versions[row]; }
+        [[nodiscard]] bool IsDisabled(const size_t row) const { return disabled[row] != 0; }
+        [[nodiscard]] const std::string& GetChannel(const size_t row) const { return channelNames[channels[row]]; }
+
+        /**
+         * \brief Finds the latest release that isn't disabled.
+         * \param channel Only consider releases of this channel, empty for any.
+         * \return The row or empty if there is none.
+         */
+        [[nodiscard]] std::optional<size_t> FindLatestEnabled(std::string_view channel = {}) const;
+
+        /**
+         * \brief Gets all releases that aren't disabled and newer than the given version.
+         * \return The rows, latest first.
+         */
+        [[nodiscard]] std::span<const uint32_t> GetEnabledNewerThan(const util::Version& version) const;
+
+        /**
+         * \brief Decodes the full release of a row.
+         */
+        [[nodiscard]] UpdateRelease Materialize(size_t row) const;
+
+        /**
+         * \brief Captures the decoded columns and the encoded records as they are.
+         * \remarks Restoring it with FromSnapshot needs neither parsing nor sorting the releases again.
+         */
+        [[nodiscard]] json ToSnapshot() const;
+
+        /**
+         * \brief Restores an index captured by ToSnapshot.
+         * \return False if the snapshot is damaged, the index is left empty then.
+         */
+        bool FromSnapshot(const json& snapshot);
+    };
+
+    void to_json(json& j, const ReleaseIndex& index);
+    void from_json(const json& j, ReleaseIndex& index);
+
     /**
      * \brief Update instance configuration. Parameters applying to the entire product/tenant.
      */
@@ -279,30 +482,27 @@ namespace models
         std::optional<std::string> latestVersion;
         /** URL of the latest updater binary */
         std::optional<std::string> latestUrl;
+        /** The (optional) checksum of the updater binary behind latestUrl */
+        std::optional<ChecksumParameters> latestChecksum;
         /** Optional URL pointing to an emergency announcement web page */
         std::optional<std::string> emergencyUrl;
         /** The exit code parameters */
         std::optional<ExitCodeCheck> exitCode;
+        /** Overrides the stall detection limits of payload downloads */
+        std::optional<TransferTimeouts> downloadTimeouts;
 
         /**
-         * \brief Converts the version string to a SemVer type.
-         * \return The parsed version.
+         * \brief Parses the latest updater version string.
+         * \return The parsed version, 0.0.0 if missing or invalid.
          */
-        semver::version GetSemVersion() const
+        util::Version GetVersion() const
         {
             if (!latestVersion.has_value())
             {
-                return semver::version{0, 0, 0};
+                return util::Version{};
             }
 
-            try
-            {
-                return semver::version{latestVersion.value()};
-            }
-            catch (...) // couldn't convert version string
-            {
-                return semver::version{0, 0, 0};
-            }
+            return util::Version::Parse(latestVersion.value()).value_or(util::Version{});
         }        
     };
 
@@ -311,8 +511,10 @@ namespace models
         updatesDisabled,
         latestVersion,
         latestUrl,
+        latestChecksum,
         emergencyUrl,
-        exitCode
+        exitCode,
+        downloadTimeouts
     )
 
     /**
@@ -326,7 +528,7 @@ namespace models
         /** The (optional) shared settings */
         std::optional<SharedConfig> shared;
         /** The available releases */
-        std::vector<UpdateRelease> releases;
+        ReleaseIndex releases;
     };
 
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_DEFAULT(
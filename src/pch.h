@@ -13,6 +13,9 @@
 #include <comdef.h>
 #include <ole2.h>
 #include <taskschd.h>
+#include <shlobj.h>
+#include <windns.h>
+#include <dpapi.h>
 
 // 
 // ImGui, Fonts
@@ -33,12 +36,13 @@
 // Utility packages
 // 
 #include <argh.h>
-#include <neargye/semver.hpp>
 #include <magic_enum.hpp>
 #include <winreg/WinReg.hpp>
 #include <hash-library/md5.h>
 #include <hash-library/sha1.h>
 #include <hash-library/sha256.h>
+#include <blake3.h>
+#include <xxhash.h>
 #include <scope_guard.hpp>
 #include <nlohmann/json.hpp>
 
@@ -57,10 +61,16 @@
 #include <tuple>
 #include <random>
 #include <algorithm>
+#include <numeric>
 #include <locale>
 #include <regex>
 #include <future>
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include <variant>
+#include <span>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -0,0 +1,79 @@
+// Checks how the verdicts of composite detection rules are combined, builds without Windows headers
+
+#include "../models/DetectionMode.hpp"
+
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+using models::DetectionMode;
+using models::DetectionVerdict;
+
+namespace
+{
+    int failures = 0;
+
+    constexpr auto Failed = DetectionVerdict::Failed;
+    constexpr auto UpToDate = DetectionVerdict::UpToDate;
+    constexpr auto Outdated = DetectionVerdict::Outdated;
+
+    std::string Describe(const std::optional<bool>& result)
+    {
+        if (!result.has_value())
+        {
+            return "error";
+        }
+
+        return result.value() ? "outdated" : "up to date";
+    }
+
+    void Expect(const char* name, const DetectionMode mode, const std::vector<DetectionVerdict>& verdicts,
+                const std::optional<bool>& expected)
+    {
+        const auto result = models::CombineVerdicts(mode, verdicts);
+
+        if (result != expected)
+        {
+            std::printf("FAIL %s: got %s, expected %s\n", name, Describe(result).c_str(), Describe(expected).c_str());
+            failures++;
+        }
+    }
+
+    void ExpectConclusive(const char* name, const DetectionMode mode, const DetectionVerdict verdict,
+                          const bool expected)
+    {
+        if (models::IsConclusive(mode, verdict) != expected)
+        {
+            std::printf("FAIL %s: expected %s\n", name, expected ? "conclusive" : "not conclusive");
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    Expect("All, all up to date", DetectionMode::All, {UpToDate, UpToDate}, false);
+    Expect("All, one outdated", DetectionMode::All, {UpToDate, Outdated}, true);
+    Expect("All, first rule fails", DetectionMode::All, {Failed, UpToDate}, std::nullopt);
+    Expect("All, stops at the first outdated", DetectionMode::All, {Outdated, Failed}, true);
+
+    Expect("Any, one up to date", DetectionMode::Any, {Outdated, UpToDate}, false);
+    Expect("Any, all outdated", DetectionMode::Any, {Outdated, Outdated}, true);
+    Expect("Any, first rule fails, next up to date", DetectionMode::Any, {Failed, UpToDate}, false);
+    Expect("Any, first rule fails, next outdated", DetectionMode::Any, {Failed, Outdated}, true);
+    Expect("Any, all rules fail", DetectionMode::Any, {Failed, Failed}, std::nullopt);
+
+    Expect("FirstMatch, first rule decides", DetectionMode::FirstMatch, {Outdated, UpToDate}, true);
+    Expect("FirstMatch, falls through failures", DetectionMode::FirstMatch, {Failed, UpToDate}, false);
+    Expect("FirstMatch, all rules fail", DetectionMode::FirstMatch, {Failed, Failed}, std::nullopt);
+
+    // the evaluation carries on past a failed rule unless all rules must agree
+    ExpectConclusive("All, failed rule", DetectionMode::All, Failed, true);
+    ExpectConclusive("Any, failed rule", DetectionMode::Any, Failed, false);
+    ExpectConclusive("FirstMatch, failed rule", DetectionMode::FirstMatch, Failed, false);
+
+    std::printf("%s\n", failures == 0 ? "All detection mode tests passed" : "Detection mode tests failed");
+
+    return failures == 0 ? 0 : 1;
+}
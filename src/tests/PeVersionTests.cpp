@@ -0,0 +1,157 @@
+// Checks the PE version parser against the images in fixtures, builds without Windows headers
+
+#include "../PeVersion.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    std::vector<uint8_t> LoadFixture(const std::string& name)
+    {
+        std::ifstream stream(std::filesystem::path(FIXTURES_DIR) / name, std::ios::binary);
+
+        if (!stream.is_open())
+        {
+            std::printf("FAIL %s: fixture not found\n", name.c_str());
+            failures++;
+            return {};
+        }
+
+        return {std::istreambuf_iterator(stream), std::istreambuf_iterator<char>()};
+    }
+
+    /**
+     * \brief Places the headers and sections at their relative virtual addresses, like the loader does.
+     */
+    std::vector<uint8_t> MapImage(const std::vector<uint8_t>& file)
+    {
+        auto read32 = [&file](const size_t offset)
+        {
+            uint32_t value;
+            std::memcpy(&value, file.data() + offset, sizeof(value));
+            return value;
+        };
+
+        auto read16 = [&file](const size_t offset)
+        {
+            uint16_t value;
+            std::memcpy(&value, file.data() + offset, sizeof(value));
+            return value;
+        };
+
+        const size_t fileHeader = read32(0x3C) + 4;
+        const size_t optionalHeader = fileHeader + 20;
+        const uint16_t sectionCount = read16(fileHeader + 2);
+        const size_t sectionTable = optionalHeader + read16(fileHeader + 16);
+        const uint32_t imageSize = read32(optionalHeader + 56);
+        const uint32_t headersSize = read32(optionalHeader + 60);
+
+        std::vector<uint8_t> image(imageSize);
+        std::copy_n(file.begin(), headersSize, image.begin());
+
+        for (uint16_t index = 0; index < sectionCount; index++)
+        {
+            const size_t section = sectionTable + index * 40;
+            const uint32_t virtualSize = read32(section + 8);
+            const uint32_t virtualAddress = read32(section + 12);
+            const uint32_t rawSize = read32(section + 16);
+            const uint32_t rawOffset = read32(section + 20);
+
+            std::copy_n(file.begin() + rawOffset, std::min(rawSize, virtualSize), image.begin() + virtualAddress);
+        }
+
+        return image;
+    }
+
+    void ExpectVersion(const std::string& name, const std::vector<uint8_t>& image, const util::pe::Layout layout)
+    {
+        const auto version = util::pe::ReadFixedVersion(image, layout);
+
+        constexpr std::array<uint16_t, 4> expectedFile{1, 2, 3, 4};
+        constexpr std::array<uint16_t, 4> expectedProduct{5, 6, 7, 65535};
+
+        if (!version.has_value())
+        {
+            std::printf("FAIL %s: no version found\n", name.c_str());
+            failures++;
+        }
+        else if (version.value().fileVersion != expectedFile || version.value().productVersion != expectedProduct)
+        {
+            const auto& [file, product] = version.value();
+
+            std::printf("FAIL %s: got %u.%u.%u.%u / %u.%u.%u.%u\n", name.c_str(),
+                        file[0], file[1], file[2], file[3], product[0], product[1], product[2], product[3]);
+            failures++;
+        }
+    }
+
+    void ExpectNoVersion(const std::string& name, const std::vector<uint8_t>& image)
+    {
+        if (util::pe::ReadFixedVersion(image).has_value())
+        {
+            std::printf("FAIL %s: version found in damaged image\n", name.c_str());
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    for (const auto* name : {"x86.dll", "x64.dll", "arm64.dll"})
+    {
+        const auto file = LoadFixture(name);
+
+        if (file.empty())
+        {
+            continue;
+        }
+
+        ExpectVersion(name, file, util::pe::Layout::File);
+        ExpectVersion(std::string(name) + " (mapped)", MapImage(file), util::pe::Layout::Image);
+    }
+
+    for (const auto* name : {
+             "x64-no-version.dll",
+             "x64-truncated-headers.dll",
+             "x64-truncated-version.dll",
+             "x64-bad-signature.dll",
+             "x64-bad-data-rva.dll"
+         })
+    {
+        ExpectNoVersion(name, LoadFixture(name));
+    }
+
+    // every possible cut of a valid image, none may read past the end or come up with other numbers
+    const auto file = LoadFixture("x64.dll");
+    // the parser reads the VS_FIXEDFILEINFO up to the product version only
+    constexpr size_t versionEnd = 0x288 + 24;
+
+    for (size_t length = 0; length < file.size(); length++)
+    {
+        const std::vector prefix(file.begin(), file.begin() + static_cast<std::ptrdiff_t>(length));
+        const std::string name = "x64.dll cut at " + std::to_string(length);
+
+        if (length < versionEnd)
+        {
+            ExpectNoVersion(name, prefix);
+        }
+        else
+        {
+            ExpectVersion(name, prefix, util::pe::Layout::File);
+        }
+    }
+
+    std::printf("%s\n", failures == 0 ? "All PE version tests passed" : "PE version tests failed");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Rebuilds the PE fixtures from version.rc, needs llvm-rc and an lld-link compatible linker.
+# The damaged variants are patched copies of the x64 image, the offsets match its layout:
+# resource section at file offset 0x200, data entry RVA at 0x248, VS_FIXEDFILEINFO at 0x288.
+set -e
+cd "$(dirname "$0")"
+
+LLD_LINK=${LLD_LINK:-lld-link}
+
+llvm-rc /no-preprocess /fo version.res version.rc
+# resources, but no version among them
+printf '1 RCDATA { "fixture" }\n' > data.rc
+llvm-rc /no-preprocess /fo data.res data.rc
+
+for machine in x86 x64 arm64; do
+    $LLD_LINK /dll /noentry /machine:$machine /timestamp:0 /out:$machine.dll version.res
+done
+
+$LLD_LINK /dll /noentry /machine:x64 /timestamp:0 /out:x64-no-version.dll data.res
+rm -f ./*.lib ./*.res data.rc
+
+# ends inside the optional header
+head -c 200 x64.dll > x64-truncated-headers.dll
+# ends right after the VS_FIXEDFILEINFO signature
+head -c 658 x64.dll > x64-truncated-version.dll
+
+cp x64.dll x64-bad-signature.dll
+printf '\000' | dd of=x64-bad-signature.dll bs=1 seek=$((0x288)) conv=notrunc status=none
+
+cp x64.dll x64-bad-data-rva.dll
+printf '\000\377\377\377' | dd of=x64-bad-data-rva.dll bs=1 seek=$((0x248)) conv=notrunc status=none
@@ -1,10 +1,42 @@
 #include "pch.h"
 #include "Common.h"
+#include "PeVersion.hpp"
 
 
 EXTERN_C IMAGE_DOS_HEADER __ImageBase;
 
 
+namespace
+{
+	/**
+	 * \brief Reads the version resource out of a mapped view.
+	 * \return False if there is none or the view couldn't be paged in, e.g. because the network share went away.
+	 * \remarks Must not hold objects with destructors, __try can't unwind them.
+	 */
+	bool ReadMappedVersion(const void* view, const size_t size, const util::pe::Layout layout,
+	                       util::pe::FixedVersion& version)
+	{
+		__try
+		{
+			const auto result = util::pe::ReadFixedVersion(
+				std::span(static_cast<const uint8_t*>(view), size), layout);
+
+			if (!result.has_value())
+			{
+				return false;
+			}
+
+			version = result.value();
+			return true;
+		}
+		__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+		{
+			return false;
+		}
+	}
+}
+
+
 namespace util
 {
 	std::filesystem::path GetImageBasePathW()
@@ -20,39 +52,83 @@ namespace util
 		return std::wstring(myPath);
 	}
 
-	semver::version GetVersionFromFile(const std::filesystem::path& filePath)
+	std::optional<Version> GetVersionFromFile(const std::filesystem::path& filePath)
 	{
-		DWORD verHandle = 0;
-		UINT size = 0;
-		LPBYTE lpBuffer = nullptr;
-		const DWORD verSize = GetFileVersionInfoSizeA(filePath.string().c_str(), &verHandle);
-		std::stringstream versionString;
+		const HANDLE handle = CreateFileW(
+			filePath.wstring().c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr
+		);
 
-		if (verSize != NULL)
+		if (handle == INVALID_HANDLE_VALUE)
 		{
-			const auto verData = new char[verSize];
+			spdlog::error("Failed to open {}, error {}", filePath.string(), GetLastError());
+			return std::nullopt;
+		}
 
-			if (GetFileVersionInfoA(filePath.string().c_str(), verHandle, verSize, verData))
-			{
-				if (VerQueryValueA(verData, "\\", (VOID FAR * FAR*)&lpBuffer, &size))
-				{
-					if (size)
-					{
-						const auto* verInfo = (VS_FIXEDFILEINFO*)lpBuffer;
-						if (verInfo->dwSignature == 0xfeef04bd)
-						{
-							versionString
-								<< static_cast<ULONG>(HIWORD(verInfo->dwProductVersionMS)) << "."
-								<< static_cast<ULONG>(LOWORD(verInfo->dwProductVersionMS)) << "."
-								<< static_cast<ULONG>(HIWORD(verInfo->dwProductVersionLS));
-						}
-					}
-				}
-			}
-			delete[] verData;
+		auto handleGuard = sg::make_scope_guard([handle]() noexcept { CloseHandle(handle); });
+
+		LARGE_INTEGER size{};
+
+		// empty files can't be mapped and have no resources anyway
+		if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+		{
+			return std::nullopt;
+		}
+
+		const HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mapping == nullptr)
+		{
+			spdlog::error("Failed to map {}, error {}", filePath.string(), GetLastError());
+			return std::nullopt;
+		}
+
+		auto mappingGuard = sg::make_scope_guard([mapping]() noexcept { CloseHandle(mapping); });
+
+		// only the pages the parser actually reads get faulted in
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		if (view == nullptr)
+		{
+			spdlog::error("Failed to map view of {}, error {}", filePath.string(), GetLastError());
+			return std::nullopt;
+		}
+
+		auto viewGuard = sg::make_scope_guard([view]() noexcept { UnmapViewOfFile(view); });
+
+		pe::FixedVersion version;
+
+		if (!ReadMappedVersion(view, static_cast<size_t>(size.QuadPart), pe::Layout::File, version))
+		{
+			return std::nullopt;
 		}
 
-		return semver::version{versionString.str()};
+		const auto& product = version.productVersion;
+
+		return Version(product[0], product[1], product[2], product[3]);
+	}
+
+	std::optional<Version> GetImageVersion()
+	{
+		const auto* dosHeader = &__ImageBase;
+		const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+			reinterpret_cast<const uint8_t*>(dosHeader) + dosHeader->e_lfanew);
+
+		pe::FixedVersion version;
+
+		if (!ReadMappedVersion(dosHeader, ntHeaders->OptionalHeader.SizeOfImage, pe::Layout::Image, version))
+		{
+			return std::nullopt;
+		}
+
+		const auto& product = version.productVersion;
+
+		return Version(product[0], product[1], product[2], product[3]);
 	}
 
 	bool ParseCommandLineArguments(argh::parser& cmdl)
@@ -98,6 +174,20 @@ namespace util
 		return str.substr(strBegin, strRange);
 	}
 
+	bool ParseHeaderLine(const char* buffer, const size_t length, std::string& name, std::string& value)
+	{
+		const std::string line(buffer, length);
+		const auto separator = line.find(':');
+
+		if (separator == std::string::npos)
+			return false; // status line or end of headers
+
+		name = trim(line.substr(0, separator), " \t");
+		value = trim(line.substr(separator + 1), " \t\r\n");
+
+		return true;
+	}
+
 	bool icompare_pred(unsigned char a, unsigned char b)
 	{
 		return std::tolower(a) == std::tolower(b);
@@ -131,6 +221,23 @@ namespace util
 
 		return true;
 	}
+
+	/**
+	 * \brief Replaces a file without ever leaving a partially written one behind.
+	 * \remarks Throws on failure, the previous content stays in place then.
+	 */
+	void WriteFileAtomically(const std::filesystem::path& file, const void* data, const size_t size)
+	{
+		auto pending = file;
+		pending += ".tmp";
+
+		std::ofstream stream(pending, std::ios::binary | std::ios::trunc);
+		stream.exceptions(std::ios::failbit | std::ios::badbit);
+		stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		stream.close();
+
+		std::filesystem::rename(pending, file);
+	}
 }
 
 namespace winapi